@@ -0,0 +1,52 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief BIQUAD_COEFFICIENT_BITS is the number of fraction bits of the
+ * coefficients. The poles of a low cutoff filter sit close to the unit
+ * circle, 16 bits are not enough to place them.
+ */
+#define BIQUAD_COEFFICIENT_BITS 30
+/**
+ * @brief BIQUAD_MAX_SECTIONS is the largest number of second order sections
+ * in a cascade, order 2 * BIQUAD_MAX_SECTIONS.
+ */
+#define BIQUAD_MAX_SECTIONS 8
+
+typedef enum {
+    BIQUAD_LOWPASS,
+    BIQUAD_HIGHPASS,
+    BIQUAD_BANDPASS,   /* 0 dB at the centre frequency */
+    BIQUAD_NOTCH,
+    BIQUAD_ALLPASS
+} BiquadType;
+
+/* H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2),
+ * fixedpoint according to BIQUAD_COEFFICIENT_BITS */
+typedef struct {
+    int32_t b0;
+    int32_t b1;
+    int32_t b2;
+    int32_t a1;
+    int32_t a2;
+} BiquadCoefficients;
+
+typedef struct {
+    int32_t sections;
+    int32_t channels;
+    BiquadCoefficients coefficients[BIQUAD_MAX_SECTIONS];
+    int64_t *state1;    /* [section * channels + channel] */
+    int64_t *state2;
+} BiquadCascade;
+
+int32_t biquad_design(BiquadCoefficients *coefficients, BiquadType type, int32_t frequency,
+                      int32_t sample_rate, int32_t quality);
+int32_t biquad_design_butterworth(BiquadCoefficients coefficients[], BiquadType type,
+                                  int32_t order, int32_t frequency, int32_t sample_rate);
+int32_t biquad_cascade_init(BiquadCascade *cascade, const BiquadCoefficients coefficients[],
+                            int32_t sections, int32_t channels);
+int32_t biquad_cascade_process(BiquadCascade *cascade, const int32_t in[], int32_t out[],
+                               int32_t frames);
+void biquad_cascade_reset(BiquadCascade *cascade);
+void biquad_cascade_free(BiquadCascade *cascade);
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "biquad.h"
+#include "cordic-math.h"
+
+#define BIQUAD_ROUND ((int64_t)1 << (BIQUAD_COEFFICIENT_BITS - 1))
+/* Fraction bits of sin(w0 / 2) and cos(w0 / 2) in biquad_design(), their
+ * products need twice as many */
+#define DESIGN_BITS 22
+#define DESIGN_ROUND (1 << (CORDIC_SINCOS_Q30_BITS - DESIGN_BITS - 1))
+
+/**
+ * @brief num / den as a coefficient, rounded and limited to the int32 range.
+ * num and den are fixedpoint with 2 * DESIGN_BITS fraction bits, den is at
+ * least 2^(2 * DESIGN_BITS) so it is shifted down instead of shifting num up
+ * by 30 bits.
+ */
+static int32_t ratio(int64_t num, int64_t den) {
+    const int32_t shift = 2 * DESIGN_BITS - 28;
+    int64_t q;
+
+    den >>= shift;
+    num <<= BIQUAD_COEFFICIENT_BITS - shift;
+    q = (num + (num >= 0 ? den / 2 : -den / 2)) / den;
+    if (q > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (q < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)q;
+}
+
+/**
+ * @brief Designs one second order section with the bilinear transform, the
+ * frequency is prewarped so the response is exact at the given frequency.
+ * With K = tan(w0 / 2) every coefficient is a ratio of polynomials in K,
+ * both sides are multiplied by cos^2(w0 / 2) so one cordic_sincos_q30()
+ * gives them and nothing grows towards the Nyquist frequency. Call it at
+ * configuration time, the filter itself needs no trigonometry.
+ *
+ * @param coefficients the designed section.
+ * @param type the response.
+ * @param frequency the cutoff or centre frequency, same unit as sample_rate.
+ * @param sample_rate the sample rate, frequency < sample_rate / 2.
+ * @param quality Q, fixedpoint according to CORDIC_MATH_FRACTION_BITS,
+ * 0.7071 gives a Butterworth low or high pass.
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t biquad_design(BiquadCoefficients *coefficients, BiquadType type, int32_t frequency,
+                      int32_t sample_rate, int32_t quality) {
+    int32_t s, c;
+    int64_t ss, cc, sc_q, sum, difference, den;
+
+    if (frequency <= 0 || sample_rate <= 0 || frequency >= sample_rate / 2 || quality <= 0) {
+        return -1;
+    }
+    /* w0 / 2 = frequency / (2 * sample_rate) of a turn of 2^32. The poles of
+     * a low cutoff filter move with the error of sin(w0 / 2) relative to
+     * its size, so cordic_sincos() is not exact enough */
+    cordic_sincos_q30((uint32_t)(((int64_t)frequency << 31) / sample_rate), &s, &c);
+    s = (s + DESIGN_ROUND) >> (CORDIC_SINCOS_Q30_BITS - DESIGN_BITS);
+    c = (c + DESIGN_ROUND) >> (CORDIC_SINCOS_Q30_BITS - DESIGN_BITS);
+
+    /* Fixedpoint with 2 * DESIGN_BITS fraction bits */
+    ss = (int64_t)s * s;
+    cc = (int64_t)c * c;
+    sc_q = (((int64_t)s * c) << CORDIC_MATH_FRACTION_BITS) / quality;
+    sum = ss + cc;
+    difference = 2 * (ss - cc);
+    den = sum + sc_q;
+
+    coefficients->a1 = ratio(difference, den);
+    coefficients->a2 = ratio(sum - sc_q, den);
+    switch (type) {
+    case BIQUAD_LOWPASS:
+        coefficients->b0 = ratio(ss, den);
+        coefficients->b1 = ratio(2 * ss, den);
+        coefficients->b2 = coefficients->b0;
+        break;
+    case BIQUAD_HIGHPASS:
+        coefficients->b0 = ratio(cc, den);
+        coefficients->b1 = ratio(-2 * cc, den);
+        coefficients->b2 = coefficients->b0;
+        break;
+    case BIQUAD_BANDPASS:
+        coefficients->b0 = ratio(sc_q, den);
+        coefficients->b1 = 0;
+        coefficients->b2 = -coefficients->b0;
+        break;
+    case BIQUAD_NOTCH:
+        coefficients->b0 = ratio(sum, den);
+        coefficients->b1 = coefficients->a1;
+        coefficients->b2 = coefficients->b0;
+        break;
+    case BIQUAD_ALLPASS:
+        coefficients->b0 = coefficients->a2;
+        coefficients->b1 = coefficients->a1;
+        coefficients->b2 = ratio(den, den);
+        break;
+    default:
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Designs a Butterworth low or high pass as a cascade of order / 2
+ * sections. Section k gets Q = 1 / (2 * cos((2k + 1) * 90 / order degrees)),
+ * the poles of the analog prototype.
+ *
+ * @param coefficients order / 2 sections.
+ * @param type BIQUAD_LOWPASS or BIQUAD_HIGHPASS.
+ * @param order the filter order, even, at most 2 * BIQUAD_MAX_SECTIONS.
+ * @param frequency the -3 dB frequency, same unit as sample_rate.
+ * @param sample_rate the sample rate.
+ *
+ * @return The number of sections, -1 if the arguments are invalid.
+ */
+int32_t biquad_design_butterworth(BiquadCoefficients coefficients[], BiquadType type,
+                                  int32_t order, int32_t frequency, int32_t sample_rate) {
+    if ((type != BIQUAD_LOWPASS && type != BIQUAD_HIGHPASS) || order < 2 || (order & 1) != 0 ||
+        order > 2 * BIQUAD_MAX_SECTIONS) {
+        return -1;
+    }
+    for (int32_t k = 0; k < order / 2; k++) {
+        /* (2k + 1) * 90 / order degrees is (2k + 1) / (4 * order) of a turn */
+        int32_t s, c, quality;
+
+        cordic_sincos_q30((uint32_t)(((int64_t)(2 * k + 1) << 30) / order), &s, &c);
+        quality = (int32_t)(((int64_t)1 << (CORDIC_MATH_FRACTION_BITS +
+                                             CORDIC_SINCOS_Q30_BITS - 1)) / c);
+
+        if (biquad_design(&coefficients[k], type, frequency, sample_rate, quality) != 0) {
+            return -1;
+        }
+    }
+    return order / 2;
+}
+
+/**
+ * @brief Sets up a cascade of sections that runs over many channels. The
+ * state of a section lies contiguous over the channels so the inner loop of
+ * biquad_cascade_process() runs over the channels without dependencies and
+ * the compiler can vectorize it. All memory is allocated here.
+ *
+ * @param cascade the BiquadCascade to set up.
+ * @param coefficients the sections, shared by every channel.
+ * @param sections the number of sections, at most BIQUAD_MAX_SECTIONS.
+ * @param channels the number of channels.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t biquad_cascade_init(BiquadCascade *cascade, const BiquadCoefficients coefficients[],
+                            int32_t sections, int32_t channels) {
+    memset(cascade, 0, sizeof(BiquadCascade));
+    if (sections < 1 || sections > BIQUAD_MAX_SECTIONS || channels < 1) {
+        return -1;
+    }
+    cascade->sections = sections;
+    cascade->channels = channels;
+    memcpy(cascade->coefficients, coefficients, sizeof(BiquadCoefficients) * sections);
+    cascade->state1 = malloc(sizeof(int64_t) * sections * channels);
+    cascade->state2 = malloc(sizeof(int64_t) * sections * channels);
+    if (cascade->state1 == NULL || cascade->state2 == NULL) {
+        biquad_cascade_free(cascade);
+        return -1;
+    }
+    biquad_cascade_reset(cascade);
+    return 0;
+}
+
+/**
+ * @brief Filters frames of samples, one sample per channel each, with the
+ * transposed direct form II. The state keeps every product with all its
+ * fraction bits, only the output of a section is rounded. The rounding
+ * error goes back into the state with the feedback coefficients (error
+ * feedback), otherwise the poles of a low cutoff filter would amplify it by
+ * 1 / (1 + a1 + a2), which is a 2% DC error for an 8th order 50 Hz low pass
+ * at 8 kHz.
+ *
+ * @param cascade the BiquadCascade.
+ * @param in frames * channels samples, the channels of a frame next to each
+ * other, fixedpoint according to CORDIC_MATH_FRACTION_BITS. Keep them below
+ * 2^28 so the sums of the products fit in 64 bits.
+ * @param out the filtered samples, may be the same array as in.
+ * @param frames the number of frames.
+ *
+ * @return 0
+ */
+int32_t biquad_cascade_process(BiquadCascade *cascade, const int32_t in[], int32_t out[],
+                               int32_t frames) {
+    int32_t channels = cascade->channels;
+
+    for (int32_t f = 0; f < frames; f++) {
+        const int32_t *x = &in[(int64_t)f * channels];
+        int32_t *y = &out[(int64_t)f * channels];
+
+        if (x != y) {
+            memcpy(y, x, sizeof(int32_t) * channels);
+        }
+        for (int32_t s = 0; s < cascade->sections; s++) {
+            const BiquadCoefficients *c = &cascade->coefficients[s];
+            int64_t *restrict s1 = &cascade->state1[s * channels];
+            int64_t *restrict s2 = &cascade->state2[s * channels];
+
+            for (int32_t ch = 0; ch < channels; ch++) {
+                int64_t input = y[ch];
+                int64_t sum = c->b0 * input + s1[ch] + BIQUAD_ROUND;
+                int32_t output = (int32_t)(sum >> BIQUAD_COEFFICIENT_BITS);
+                /* The part of the sum the rounding dropped, fed back with
+                 * the output so the poles see the exact value */
+                int32_t error = (int32_t)(sum & ((1 << BIQUAD_COEFFICIENT_BITS) - 1)) -
+                                (int32_t)BIQUAD_ROUND;
+
+                s1[ch] = c->b1 * input - (int64_t)c->a1 * output + s2[ch] -
+                         (((int64_t)c->a1 * error + BIQUAD_ROUND) >> BIQUAD_COEFFICIENT_BITS);
+                s2[ch] = c->b2 * input - (int64_t)c->a2 * output -
+                         (((int64_t)c->a2 * error + BIQUAD_ROUND) >> BIQUAD_COEFFICIENT_BITS);
+                y[ch] = output;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Clears the state of every channel, the coefficients are kept.
+ */
+void biquad_cascade_reset(BiquadCascade *cascade) {
+    memset(cascade->state1, 0, sizeof(int64_t) * cascade->sections * cascade->channels);
+    memset(cascade->state2, 0, sizeof(int64_t) * cascade->sections * cascade->channels);
+}
+
+/**
+ * @brief Frees the memory allocated by biquad_cascade_init().
+ */
+void biquad_cascade_free(BiquadCascade *cascade) {
+    free(cascade->state1);
+    free(cascade->state2);
+    cascade->state1 = NULL;
+    cascade->state2 = NULL;
+}
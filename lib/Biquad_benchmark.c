@@ -0,0 +1,140 @@
+// Benchmarks for the Biquad library.
+//
+// Build from the lib folder:
+//   gcc -O2 -IcordicMath/include -IBiquad/include Biquad_benchmark.c cordicMath/src/*.c Biquad/src/*.c -o biquad_benchmark -lm
+//
+// An 8th order 50 Hz Butterworth low pass at 8 kHz, the hard case for fixed
+// point: the poles sit close to z = 1. The response of the designed
+// sections is compared with the ideal bilinear transform Butterworth, the
+// step response with the same cascade in double, and the cascade is timed
+// for several channel counts.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "biquad.h"
+#include "cordic-math.h"
+
+#define ORDER 8
+#define CUTOFF 50
+#define SAMPLE_RATE 8000
+#define STEP_SAMPLES 8000
+#define FRAMES 4096
+#define ROUNDS 64
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The magnitude of the cascade at frequency f in Hz
+static double cascade_gain(const BiquadCoefficients c[], int32_t sections, double f) {
+    const double scale = 1.0 / (1 << BIQUAD_COEFFICIENT_BITS);
+    double w = 2 * M_PI * f / SAMPLE_RATE, gain = 1;
+
+    for (int32_t k = 0; k < sections; k++) {
+        double nr = (c[k].b0 + c[k].b1 * cos(w) + c[k].b2 * cos(2 * w)) * scale;
+        double ni = -(c[k].b1 * sin(w) + c[k].b2 * sin(2 * w)) * scale;
+        double dr = 1 + (c[k].a1 * cos(w) + c[k].a2 * cos(2 * w)) * scale;
+        double di = -(c[k].a1 * sin(w) + c[k].a2 * sin(2 * w)) * scale;
+        gain *= sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+    }
+    return gain;
+}
+
+// The bilinear transform Butterworth, the cutoff prewarped like
+// biquad_design() does
+static double butterworth_gain(double f) {
+    double ratio = tan(M_PI * f / SAMPLE_RATE) / tan(M_PI * CUTOFF / SAMPLE_RATE);
+    return 1 / sqrt(1 + pow(ratio, 2 * ORDER));
+}
+
+static void check_response(const BiquadCoefficients c[], int32_t sections) {
+    const double frequencies[] = {0, 10, 25, 40, 50, 60, 100, 200, 400};
+    double worst = 0;
+
+    printf("%-10s %12s %12s\n", "Hz", "design dB", "ideal dB");
+    for (uint32_t i = 0; i < sizeof(frequencies) / sizeof(frequencies[0]); i++) {
+        double design = 20 * log10(cascade_gain(c, sections, frequencies[i]));
+        double ideal = 20 * log10(butterworth_gain(frequencies[i]));
+        printf("%-10.0f %12.4f %12.4f\n", frequencies[i], design, ideal);
+        // Far in the stop band a dB is a tiny absolute error
+        if (ideal > -40) {
+            worst = fmax(worst, fabs(design - ideal));
+        }
+    }
+    printf("largest difference above -40 dB: %.4f dB%s\n\n", worst,
+           worst > 0.01 ? ", the design is off" : "");
+}
+
+// A unit step through the fixed point cascade and through the same
+// coefficients in double with the transposed direct form II
+static void check_step(const BiquadCoefficients c[], int32_t sections) {
+    const double scale = 1.0 / (1 << BIQUAD_COEFFICIENT_BITS);
+    const int32_t one = 1 << CORDIC_MATH_FRACTION_BITS;
+    double s1[BIQUAD_MAX_SECTIONS] = {0}, s2[BIQUAD_MAX_SECTIONS] = {0};
+    double reference = 0, error = 0;
+    int32_t *samples = malloc(sizeof(int32_t) * STEP_SAMPLES);
+    BiquadCascade cascade;
+
+    for (int32_t n = 0; n < STEP_SAMPLES; n++) {
+        samples[n] = one;
+    }
+    biquad_cascade_init(&cascade, c, sections, 1);
+    biquad_cascade_process(&cascade, samples, samples, STEP_SAMPLES);
+
+    for (int32_t n = 0; n < STEP_SAMPLES; n++) {
+        double y = one;
+        for (int32_t k = 0; k < sections; k++) {
+            double x = y;
+            y = c[k].b0 * scale * x + s1[k];
+            s1[k] = c[k].b1 * scale * x - c[k].a1 * scale * y + s2[k];
+            s2[k] = c[k].b2 * scale * x - c[k].a2 * scale * y;
+        }
+        reference = y;
+        error = fmax(error, fabs(samples[n] - y));
+    }
+    printf("unit step (%d) after %d samples: %d, double %.1f, largest difference %.1f LSB%s\n\n",
+           one, STEP_SAMPLES, samples[STEP_SAMPLES - 1], reference, error,
+           error > 4 ? ", the cascade is off" : "");
+    biquad_cascade_free(&cascade);
+    free(samples);
+}
+
+static void benchmark_cascade(const BiquadCoefficients c[], int32_t sections) {
+    const int32_t channel_counts[] = {1, 4, 16, 64};
+
+    printf("%-10s %20s\n", "channels", "ns per sample");
+    for (uint32_t i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++) {
+        int32_t channels = channel_counts[i];
+        int32_t *samples = malloc(sizeof(int32_t) * FRAMES * channels);
+        BiquadCascade cascade;
+        double t0;
+
+        for (int32_t n = 0; n < FRAMES * channels; n++) {
+            samples[n] = (n * 7919) % 65536 - 32768;
+        }
+        biquad_cascade_init(&cascade, c, sections, channels);
+        t0 = now_seconds();
+        for (int32_t r = 0; r < ROUNDS; r++) {
+            biquad_cascade_process(&cascade, samples, samples, FRAMES);
+        }
+        printf("%-10d %20.2f\n", channels,
+               (now_seconds() - t0) * 1e9 / ((double)ROUNDS * FRAMES * channels));
+        biquad_cascade_free(&cascade);
+        free(samples);
+    }
+}
+
+int main(void) {
+    BiquadCoefficients c[BIQUAD_MAX_SECTIONS];
+    int32_t sections = biquad_design_butterworth(c, BIQUAD_LOWPASS, ORDER, CUTOFF, SAMPLE_RATE);
+
+    printf("Butterworth low pass, order %d, %d Hz at %d Hz\n\n", ORDER, CUTOFF, SAMPLE_RATE);
+    check_response(c, sections);
+    check_step(c, sections);
+    benchmark_cascade(c, sections);
+    return 0;
+}
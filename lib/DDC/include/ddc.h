@@ -0,0 +1,40 @@
+#pragma once
+
+#include "stdint.h"
+#include "nco.h"
+
+/**
+ * @brief DDC_MAX_STAGES is the largest number of CIC stages of the
+ * decimation filter. The gain ratio^stages has to stay below 2^31.
+ */
+#define DDC_MAX_STAGES 6
+
+/* One output sample of the down-converter, every demodulation at once */
+typedef struct {
+    int32_t i;          /* baseband, fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t q;
+    int32_t magnitude;  /* AM, the envelope, same format */
+    int32_t phase;      /* PM, degrees fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t frequency;  /* FM, Hz away from the carrier, fixedpoint according to
+                         * CORDIC_MATH_FRACTION_BITS, so below 32768 Hz */
+} DdcOutput;
+
+/* Digital down-converter. Every input sample is mixed with the local
+ * oscillator and integrated in the same step; at the output rate the combs,
+ * one cordic_vector() and the phase difference give the demodulated sample.
+ * Nothing is stored between the steps, so the input is read once. */
+typedef struct {
+    Nco oscillator;                        /* NCO_LOOKUP at the carrier frequency */
+    int32_t ratio;
+    int32_t stages;
+    int32_t phase;                         /* input samples since the last output */
+    int64_t gain;                          /* ratio^stages */
+    uint64_t integrators[2][DDC_MAX_STAGES];  /* [i or q][stage] */
+    uint64_t combs[2][DDC_MAX_STAGES];
+    int32_t previous_phase;
+} Ddc;
+
+int32_t ddc_init(Ddc *ddc, int32_t carrier, int32_t sample_rate, int32_t ratio, int32_t stages);
+int32_t ddc_set_carrier(Ddc *ddc, int32_t carrier);
+int32_t ddc_process(Ddc *ddc, const int32_t in[], int32_t count, DdcOutput out[]);
+void ddc_reset(Ddc *ddc);
@@ -0,0 +1,158 @@
+#include <string.h>
+
+#include "cordic-math.h"
+#include "ddc.h"
+
+#define FRACTION_BITS (32 - NCO_TABLE_BITS)
+
+/**
+ * @brief The sine of a phase from the table of an NCO_LOOKUP Nco, the same
+ * interpolation as nco_generate().
+ */
+static inline int32_t table_sine(const int32_t table[], uint32_t phase) {
+    uint32_t i = phase >> FRACTION_BITS;
+    int32_t a = (int32_t)((phase >> (FRACTION_BITS - 15)) & 0x7fff);
+
+    return table[i] + (((table[i + 1] - table[i]) * a + (1 << 14)) >> 15);
+}
+
+/**
+ * @brief Sets up a down-converter.
+ *
+ * @param ddc the Ddc to set up.
+ * @param carrier the frequency that is moved to 0 Hz, in Hz, up to half
+ * the sample rate.
+ * @param sample_rate of the input in Hz.
+ * @param ratio the decimation ratio, the output rate is sample_rate / ratio.
+ * @param stages the number of CIC stages, 1 to DDC_MAX_STAGES. Each stage
+ * attenuates the signals that alias onto the baseband more.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the gain
+ * ratio^stages reaches 2^31.
+ */
+int32_t ddc_init(Ddc *ddc, int32_t carrier, int32_t sample_rate, int32_t ratio, int32_t stages) {
+    memset(ddc, 0, sizeof(Ddc));
+    if (ratio < 1 || stages < 1 || stages > DDC_MAX_STAGES) {
+        return -1;
+    }
+    ddc->gain = 1;
+    for (int32_t s = 0; s < stages; s++) {
+        ddc->gain *= ratio;
+        if (ddc->gain >= ((int64_t)1 << 31)) {
+            return -1;
+        }
+    }
+    if (nco_init(&ddc->oscillator, NCO_LOOKUP, 0, sample_rate) != 0 ||
+        ddc_set_carrier(ddc, carrier) != 0) {
+        return -1;
+    }
+    ddc->ratio = ratio;
+    ddc->stages = stages;
+    return 0;
+}
+
+/**
+ * @brief Tunes to another carrier. The oscillator keeps its phase, so the
+ * change does not disturb the decimation filter.
+ *
+ * @param ddc the Ddc.
+ * @param carrier in Hz.
+ *
+ * @return 0 on success, -1 if the carrier is beyond half the sample rate.
+ */
+int32_t ddc_set_carrier(Ddc *ddc, int32_t carrier) {
+    int32_t sample_rate = ddc->oscillator.sample_rate;
+
+    if (carrier > sample_rate / 2 || carrier < -(sample_rate / 2)) {
+        return -1;
+    }
+    nco_set_frequency_word(&ddc->oscillator,
+                           (uint32_t)(((int64_t)carrier << 32) / sample_rate));
+    return 0;
+}
+
+/**
+ * @brief Down-converts and demodulates a block of real samples in one pass.
+ * A sample is multiplied by the cosine and the negative sine of the
+ * oscillator and goes straight into the integrators of the CIC filter of I
+ * and Q. Every ratio samples the combs run, the result is divided by the
+ * gain and cordic_vector() gives the envelope and the phase; the frequency
+ * is the phase difference to the previous output.
+ *
+ * @param ddc the Ddc.
+ * @param in the samples, fixedpoint according to CORDIC_MATH_FRACTION_BITS.
+ * @param count the number of samples, any count, the decimation phase
+ * carries over to the next call.
+ * @param out room for count / ratio + 1 outputs.
+ *
+ * @return The number of outputs.
+ */
+int32_t ddc_process(Ddc *ddc, const int32_t in[], int32_t count, DdcOutput out[]) {
+    const int32_t *table = ddc->oscillator.table;
+    uint32_t phase = ddc->oscillator.phase, step = ddc->oscillator.step;
+    uint64_t *integrate_i = ddc->integrators[0];
+    uint64_t *integrate_q = ddc->integrators[1];
+    int32_t stages = ddc->stages, produced = 0;
+    int64_t half = ddc->gain / 2;
+
+    for (int32_t n = 0; n < count; n++) {
+        int64_t x = in[n];
+        /* e^-j phase, the cosine is a quarter turn ahead */
+        int32_t cosine = table_sine(table, phase + (1u << 30));
+        int32_t sine = table_sine(table, phase);
+
+        phase += step;
+        integrate_i[0] += (uint64_t)((x * cosine) >> CORDIC_MATH_FRACTION_BITS);
+        integrate_q[0] -= (uint64_t)((x * sine) >> CORDIC_MATH_FRACTION_BITS);
+        for (int32_t s = 1; s < stages; s++) {
+            integrate_i[s] += integrate_i[s - 1];
+            integrate_q[s] += integrate_q[s - 1];
+        }
+        if (++ddc->phase < ddc->ratio) {
+            continue;
+        }
+        ddc->phase = 0;
+
+        int64_t baseband[2];
+        for (int32_t c = 0; c < 2; c++) {
+            uint64_t value = ddc->integrators[c][stages - 1];
+            for (int32_t s = 0; s < stages; s++) {
+                uint64_t previous = ddc->combs[c][s];
+                ddc->combs[c][s] = value;
+                value -= previous;
+            }
+            /* The true value fits in 64 bits, the cast undoes the wrap */
+            baseband[c] = (int64_t)value;
+            baseband[c] = (baseband[c] + (baseband[c] < 0 ? -half : half)) / ddc->gain;
+        }
+
+        DdcOutput *y = &out[produced++];
+        int32_t difference;
+
+        y->i = (int32_t)baseband[0];
+        y->q = (int32_t)baseband[1];
+        cordic_vector(y->q, y->i, &y->magnitude, &y->phase);
+        difference = y->phase - ddc->previous_phase;
+        if (difference > (180 << CORDIC_MATH_FRACTION_BITS)) {
+            difference -= 360 << CORDIC_MATH_FRACTION_BITS;
+        } else if (difference < -(180 << CORDIC_MATH_FRACTION_BITS)) {
+            difference += 360 << CORDIC_MATH_FRACTION_BITS;
+        }
+        /* Degrees per output sample to Hz */
+        y->frequency = (int32_t)((int64_t)difference * ddc->oscillator.sample_rate /
+                                 (360 * (int64_t)ddc->ratio));
+        ddc->previous_phase = y->phase;
+    }
+    ddc->oscillator.phase = phase;
+    return produced;
+}
+
+/**
+ * @brief Clears the decimation filter, the oscillator keeps running.
+ */
+void ddc_reset(Ddc *ddc) {
+    ddc->phase = 0;
+    ddc->previous_phase = 0;
+    memset(ddc->integrators, 0, sizeof(ddc->integrators));
+    memset(ddc->combs, 0, sizeof(ddc->combs));
+}
@@ -0,0 +1,127 @@
+// Benchmarks for the DDC library.
+//
+// Build from the lib folder:
+//   gcc -O2 -IcordicMath/include -INCO/include -IDecimator/include -IDDC/include DDC_benchmark.c cordicMath/src/*.c NCO/src/*.c Decimator/src/*.c DDC/src/*.c -o ddc_benchmark -lm
+//
+// An FM signal on a 96 kHz carrier, sampled at 1.024 MHz, is brought to
+// baseband and decimated by 32. The fused Ddc is compared with the same
+// steps as separate passes over memory: nco_generate(), the mixing, a
+// CicDecimator and cordic_vector().
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cordic-math.h"
+#include "ddc.h"
+#include "decimator.h"
+#include "nco.h"
+
+#define SAMPLE_RATE 1024000
+#define CARRIER 96000
+#define DEVIATION 5000.0
+#define TONE 1000.0
+#define RATIO 32
+#define STAGES 4
+#define SAMPLES (SAMPLE_RATE / 4)
+#define BLOCK 4096
+#define ROUNDS 16
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The same down-conversion with a pass over memory per step
+static int32_t separate_passes(Nco *nco, CicDecimator *cic, const int32_t in[], int32_t count,
+                               int32_t frequency[], int32_t *previous) {
+    static int32_t sine[BLOCK], cosine[BLOCK], iq[2 * BLOCK];
+    int32_t produced, output_rate = SAMPLE_RATE / RATIO;
+
+    nco_generate(nco, sine, cosine, count);
+    for (int32_t n = 0; n < count; n++) {
+        iq[2 * n] = (int32_t)(((int64_t)in[n] * cosine[n]) >> CORDIC_MATH_FRACTION_BITS);
+        iq[2 * n + 1] = (int32_t)(-((int64_t)in[n] * sine[n]) >> CORDIC_MATH_FRACTION_BITS);
+    }
+    produced = cic_decimator_process(cic, iq, iq, count);
+    for (int32_t n = 0; n < produced; n++) {
+        int32_t phase, difference;
+        cordic_vector(iq[2 * n + 1], iq[2 * n], NULL, &phase);
+        difference = phase - *previous;
+        if (difference > (180 << CORDIC_MATH_FRACTION_BITS)) {
+            difference -= 360 << CORDIC_MATH_FRACTION_BITS;
+        } else if (difference < -(180 << CORDIC_MATH_FRACTION_BITS)) {
+            difference += 360 << CORDIC_MATH_FRACTION_BITS;
+        }
+        frequency[n] = (int32_t)((int64_t)difference * output_rate / 360);
+        *previous = phase;
+    }
+    return produced;
+}
+
+int main(void) {
+    static DdcOutput out[BLOCK / RATIO + 1];
+    static int32_t frequency[BLOCK / RATIO + 1];
+    int32_t *signal = malloc(sizeof(int32_t) * SAMPLES);
+    double phase = 0, t0, t_fused, t_separate, error = 0;
+    int32_t previous = 0;
+    int64_t outputs = 0;
+    Ddc ddc;
+    Nco nco;
+    CicDecimator cic;
+
+    if (signal == NULL) {
+        return 1;
+    }
+    /* The carrier swings DEVIATION Hz around CARRIER at TONE Hz */
+    for (int32_t n = 0; n < SAMPLES; n++) {
+        double t = (double)n / SAMPLE_RATE;
+        signal[n] = (int32_t)(0.5 * 65536 * cos(phase));
+        phase += 2 * M_PI * (CARRIER + DEVIATION * sin(2 * M_PI * TONE * t)) / SAMPLE_RATE;
+    }
+
+    ddc_init(&ddc, CARRIER, SAMPLE_RATE, RATIO, STAGES);
+    t0 = now_seconds();
+    for (int32_t r = 0; r < ROUNDS; r++) {
+        for (int32_t n = 0; n < SAMPLES; n += BLOCK) {
+            int32_t count = SAMPLES - n < BLOCK ? SAMPLES - n : BLOCK;
+            int32_t produced = ddc_process(&ddc, &signal[n], count, out);
+
+            /* Compare the first round with the modulation. An output
+             * belongs to the last of its RATIO inputs, the CIC delays it by
+             * STAGES * (RATIO - 1) / 2 inputs and the phase difference sits
+             * half an output back */
+            for (int32_t i = 0; r == 0 && i < produced; i++, outputs++) {
+                double t = ((outputs + 0.5) * RATIO - 1 - STAGES * (RATIO - 1) / 2.0) /
+                           SAMPLE_RATE;
+                if (outputs > 2 * STAGES) {
+                    error = fmax(error, fabs(out[i].frequency / 65536.0 -
+                                             DEVIATION * sin(2 * M_PI * TONE * t)));
+                }
+            }
+        }
+    }
+    t_fused = now_seconds() - t0;
+
+    nco_init(&nco, NCO_LOOKUP, 0, SAMPLE_RATE);
+    nco_set_frequency_word(&nco, (uint32_t)(((int64_t)CARRIER << 32) / SAMPLE_RATE));
+    cic_decimator_init(&cic, RATIO, STAGES, 2);
+    t0 = now_seconds();
+    for (int32_t r = 0; r < ROUNDS; r++) {
+        for (int32_t n = 0; n < SAMPLES; n += BLOCK) {
+            int32_t count = SAMPLES - n < BLOCK ? SAMPLES - n : BLOCK;
+            separate_passes(&nco, &cic, &signal[n], count, frequency, &previous);
+        }
+    }
+    t_separate = now_seconds() - t0;
+    cic_decimator_free(&cic);
+
+    printf("FM, %d Hz carrier at %d Hz, decimated by %d\n", CARRIER, SAMPLE_RATE, RATIO);
+    printf("%-20s %10.1f Msps\n", "Ddc, one pass", (double)SAMPLES * ROUNDS / t_fused * 1e-6);
+    printf("%-20s %10.1f Msps\n", "separate passes",
+           (double)SAMPLES * ROUNDS / t_separate * 1e-6);
+    printf("largest FM error %.1f Hz of %.0f Hz deviation\n", error, DEVIATION);
+    free(signal);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief DECIMATOR_MAX_STAGES is the largest number of integrator and comb
+ * stages of a CicDecimator. The gain ratio^stages has to stay below 2^31.
+ */
+#define DECIMATOR_MAX_STAGES 6
+/**
+ * @brief DECIMATOR_COEFFICIENT_BITS is the number of fraction bits of the
+ * FirDecimator taps, the same as BIQUAD_COEFFICIENT_BITS.
+ */
+#define DECIMATOR_COEFFICIENT_BITS 30
+
+/* Cascaded integrator comb decimator, no multiplications. The integrators
+ * run at the input rate and wrap around, which the combs undo at the output
+ * rate. Its response droops towards the output Nyquist frequency, a short
+ * FirDecimator after it flattens the passband. */
+typedef struct {
+    int32_t ratio;
+    int32_t stages;
+    int32_t channels;
+    int32_t phase;          /* input frames since the last output */
+    int64_t gain;           /* ratio^stages */
+    uint64_t *integrators;  /* [stage * channels + channel] */
+    uint64_t *combs;        /* the previous comb input, same layout */
+} CicDecimator;
+
+/* Polyphase FIR decimator, only every ratio-th output is calculated so a
+ * tap costs one multiplication per output frame */
+typedef struct {
+    int32_t ratio;
+    int32_t taps;
+    int32_t channels;
+    int32_t phase;          /* input frames since the last output */
+    int32_t position;       /* where the next input frame is written */
+    int32_t *coefficients;  /* reversed, fixedpoint according to DECIMATOR_COEFFICIENT_BITS */
+    int32_t *history;       /* [channel * 2 * taps + n], every frame is stored twice */
+} FirDecimator;
+
+int32_t cic_decimator_init(CicDecimator *cic, int32_t ratio, int32_t stages, int32_t channels);
+int32_t cic_decimator_process(CicDecimator *cic, const int32_t in[], int32_t out[],
+                              int32_t frames);
+void cic_decimator_reset(CicDecimator *cic);
+void cic_decimator_free(CicDecimator *cic);
+int32_t fir_decimator_design(int32_t coefficients[], int32_t taps, int32_t ratio);
+int32_t fir_decimator_init(FirDecimator *fir, const int32_t coefficients[], int32_t taps,
+                           int32_t ratio, int32_t channels);
+int32_t fir_decimator_process(FirDecimator *fir, const int32_t in[], int32_t out[],
+                              int32_t frames);
+void fir_decimator_reset(FirDecimator *fir);
+void fir_decimator_free(FirDecimator *fir);
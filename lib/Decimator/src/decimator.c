@@ -0,0 +1,283 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cordic-math.h"
+#include "decimator.h"
+
+#define ONE ((int64_t)1 << DECIMATOR_COEFFICIENT_BITS)
+/* pi with DECIMATOR_COEFFICIENT_BITS fraction bits */
+#define PI_FIXED ((int64_t)3373259426)
+
+/**
+ * @brief Sets up a CIC decimator with a differential delay of one.
+ *
+ * @param cic the CicDecimator to set up.
+ * @param ratio the decimation ratio, ratio >= 1.
+ * @param stages the number of integrator and comb pairs, 1 to
+ * DECIMATOR_MAX_STAGES. More stages attenuate the aliases more but droop
+ * more.
+ * @param channels the number of interleaved channels.
+ *
+ * @return 0 on success, -1 if the arguments are invalid, the gain
+ * ratio^stages reaches 2^31 or the memory could not be allocated.
+ */
+int32_t cic_decimator_init(CicDecimator *cic, int32_t ratio, int32_t stages, int32_t channels) {
+    memset(cic, 0, sizeof(CicDecimator));
+    if (ratio < 1 || stages < 1 || stages > DECIMATOR_MAX_STAGES || channels < 1) {
+        return -1;
+    }
+    cic->gain = 1;
+    for (int32_t s = 0; s < stages; s++) {
+        cic->gain *= ratio;
+        if (cic->gain >= ((int64_t)1 << 31)) {
+            return -1;
+        }
+    }
+    cic->ratio = ratio;
+    cic->stages = stages;
+    cic->channels = channels;
+    cic->integrators = malloc(sizeof(uint64_t) * stages * channels);
+    cic->combs = malloc(sizeof(uint64_t) * stages * channels);
+    if (cic->integrators == NULL || cic->combs == NULL) {
+        cic_decimator_free(cic);
+        return -1;
+    }
+    cic_decimator_reset(cic);
+    return 0;
+}
+
+/**
+ * @brief Decimates frames of samples, one sample per channel each. The
+ * integrators use unsigned arithmetic so the wrap around is defined, the
+ * output is divided by the gain so it has the scale of the input.
+ *
+ * @param cic the CicDecimator.
+ * @param in frames * channels samples, the channels of a frame next to each
+ * other.
+ * @param out room for frames / ratio + 1 output frames.
+ * @param frames the number of input frames, any count, the phase carries
+ * over to the next call.
+ *
+ * @return The number of output frames.
+ */
+int32_t cic_decimator_process(CicDecimator *cic, const int32_t in[], int32_t out[],
+                              int32_t frames) {
+    int32_t channels = cic->channels, stages = cic->stages, produced = 0;
+    int64_t half = cic->gain / 2;
+
+    for (int32_t f = 0; f < frames; f++) {
+        const int32_t *x = &in[(int64_t)f * channels];
+        uint64_t *restrict integrator = cic->integrators;
+
+        for (int32_t ch = 0; ch < channels; ch++) {
+            integrator[ch] += (uint64_t)(int64_t)x[ch];
+        }
+        for (int32_t s = 1; s < stages; s++) {
+            for (int32_t ch = 0; ch < channels; ch++) {
+                integrator[s * channels + ch] += integrator[(s - 1) * channels + ch];
+            }
+        }
+        if (++cic->phase < cic->ratio) {
+            continue;
+        }
+        cic->phase = 0;
+
+        int32_t *y = &out[(int64_t)produced * channels];
+        for (int32_t ch = 0; ch < channels; ch++) {
+            uint64_t value = integrator[(stages - 1) * channels + ch];
+            int64_t result;
+
+            for (int32_t s = 0; s < stages; s++) {
+                uint64_t previous = cic->combs[s * channels + ch];
+                cic->combs[s * channels + ch] = value;
+                value -= previous;
+            }
+            /* The true value fits in 64 bits, the cast undoes the wrap */
+            result = (int64_t)value;
+            y[ch] = (int32_t)((result + (result < 0 ? -half : half)) / cic->gain);
+        }
+        produced++;
+    }
+    return produced;
+}
+
+/**
+ * @brief Clears the integrators and combs.
+ */
+void cic_decimator_reset(CicDecimator *cic) {
+    cic->phase = 0;
+    memset(cic->integrators, 0, sizeof(uint64_t) * cic->stages * cic->channels);
+    memset(cic->combs, 0, sizeof(uint64_t) * cic->stages * cic->channels);
+}
+
+/**
+ * @brief Frees the memory allocated by cic_decimator_init().
+ */
+void cic_decimator_free(CicDecimator *cic) {
+    free(cic->integrators);
+    free(cic->combs);
+    cic->integrators = NULL;
+    cic->combs = NULL;
+}
+
+/**
+ * @brief Designs the low pass for a FirDecimator, a Hann windowed sinc with
+ * the cutoff at the output Nyquist frequency, scaled to a DC gain of
+ * exactly one. The sines come from cordic_sincos().
+ *
+ * @param coefficients room for taps coefficients, fixedpoint according to
+ * DECIMATOR_COEFFICIENT_BITS.
+ * @param taps the number of taps, 3 to 1024. About 8 * ratio taps give
+ * 40 dB of attenuation.
+ * @param ratio the decimation ratio of the filter.
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t fir_decimator_design(int32_t coefficients[], int32_t taps, int32_t ratio) {
+    const int64_t full_turn = (int64_t)360 << CORDIC_MATH_FRACTION_BITS;
+    int64_t sum = 0, center = 0;
+
+    if (taps < 3 || taps > 1024 || ratio < 1) {
+        return -1;
+    }
+    for (int32_t n = 0; n < taps; n++) {
+        /* Twice the distance to the middle, an integer for even taps too.
+         * The sinc is even, so the distance is enough */
+        int64_t m2 = 2 * n - (taps - 1) < 0 ? (taps - 1) - 2 * n : 2 * n - (taps - 1);
+        int32_t sine, cosine;
+        int64_t window, h;
+
+        cordic_sincos((int32_t)(full_turn * n / (taps - 1)), &sine, &cosine);
+        window = ((int64_t)1 << CORDIC_MATH_FRACTION_BITS) - cosine;
+
+        if (m2 == 0) {
+            /* 2 fc with fc = 1 / (2 ratio) */
+            h = ONE / ratio;
+        } else {
+            /* sin(2 pi fc m) / (pi m) = sin(180 m2 / (2 ratio)) * 2 / (pi m2) */
+            int64_t angle = (full_turn / 2 * m2 / (2 * ratio)) % full_turn;
+            cordic_sincos((int32_t)angle, &sine, &cosine);
+            h = ((int64_t)sine << (DECIMATOR_COEFFICIENT_BITS + 1)) /
+                ((PI_FIXED * m2) >> (DECIMATOR_COEFFICIENT_BITS - CORDIC_MATH_FRACTION_BITS));
+        }
+        /* The Hann window 0.5 - 0.5 cos(360 n / (taps - 1)), window is
+         * twice that */
+        coefficients[n] = (int32_t)((h * window) >> (CORDIC_MATH_FRACTION_BITS + 1));
+        sum += coefficients[n];
+    }
+
+    /* Scale to a DC gain of one, the rounding error goes to the middle tap */
+    for (int32_t n = 0; n < taps; n++) {
+        coefficients[n] = (int32_t)(((int64_t)coefficients[n] * ONE + sum / 2) / sum);
+        center += coefficients[n];
+    }
+    coefficients[taps / 2] += (int32_t)(ONE - center);
+    return 0;
+}
+
+/**
+ * @brief Sets up a polyphase FIR decimator.
+ *
+ * @param fir the FirDecimator to set up.
+ * @param coefficients the taps, fixedpoint according to
+ * DECIMATOR_COEFFICIENT_BITS, from fir_decimator_design() or any other
+ * low pass with the cutoff below the output Nyquist frequency.
+ * @param taps the number of taps.
+ * @param ratio the decimation ratio, ratio >= 1.
+ * @param channels the number of interleaved channels.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t fir_decimator_init(FirDecimator *fir, const int32_t coefficients[], int32_t taps,
+                           int32_t ratio, int32_t channels) {
+    memset(fir, 0, sizeof(FirDecimator));
+    if (taps < 1 || ratio < 1 || channels < 1) {
+        return -1;
+    }
+    fir->ratio = ratio;
+    fir->taps = taps;
+    fir->channels = channels;
+    fir->coefficients = malloc(sizeof(int32_t) * taps);
+    fir->history = malloc(sizeof(int32_t) * 2 * taps * channels);
+    if (fir->coefficients == NULL || fir->history == NULL) {
+        fir_decimator_free(fir);
+        return -1;
+    }
+    /* Reversed so the dot product runs forward over the history */
+    for (int32_t n = 0; n < taps; n++) {
+        fir->coefficients[n] = coefficients[taps - 1 - n];
+    }
+    fir_decimator_reset(fir);
+    return 0;
+}
+
+/**
+ * @brief Decimates frames of samples, one sample per channel each. Every
+ * input frame is stored, the dot product with the taps only runs for the
+ * frames that are kept. The history holds every frame twice, taps apart, so
+ * the last taps frames are always contiguous.
+ *
+ * @param fir the FirDecimator.
+ * @param in frames * channels samples, the channels of a frame next to each
+ * other.
+ * @param out room for frames / ratio + 1 output frames.
+ * @param frames the number of input frames, any count, the phase carries
+ * over to the next call.
+ *
+ * @return The number of output frames.
+ */
+int32_t fir_decimator_process(FirDecimator *fir, const int32_t in[], int32_t out[],
+                              int32_t frames) {
+    int32_t channels = fir->channels, taps = fir->taps, produced = 0;
+    const int32_t *restrict h = fir->coefficients;
+
+    for (int32_t f = 0; f < frames; f++) {
+        const int32_t *x = &in[(int64_t)f * channels];
+        int32_t position = fir->position;
+
+        for (int32_t ch = 0; ch < channels; ch++) {
+            int32_t *history = &fir->history[ch * 2 * taps];
+            history[position] = x[ch];
+            history[position + taps] = x[ch];
+        }
+        fir->position = position + 1 == taps ? 0 : position + 1;
+        if (++fir->phase < fir->ratio) {
+            continue;
+        }
+        fir->phase = 0;
+
+        /* The oldest frame is at the next write position */
+        for (int32_t ch = 0; ch < channels; ch++) {
+            const int32_t *restrict window = &fir->history[ch * 2 * taps + fir->position];
+            int64_t sum = 0;
+
+            for (int32_t n = 0; n < taps; n++) {
+                sum += (int64_t)h[n] * window[n];
+            }
+            out[(int64_t)produced * channels + ch] =
+                (int32_t)((sum + (ONE >> 1)) >> DECIMATOR_COEFFICIENT_BITS);
+        }
+        produced++;
+    }
+    return produced;
+}
+
+/**
+ * @brief Clears the history, the taps are kept.
+ */
+void fir_decimator_reset(FirDecimator *fir) {
+    fir->phase = 0;
+    fir->position = 0;
+    memset(fir->history, 0, sizeof(int32_t) * 2 * fir->taps * fir->channels);
+}
+
+/**
+ * @brief Frees the memory allocated by fir_decimator_init().
+ */
+void fir_decimator_free(FirDecimator *fir) {
+    free(fir->coefficients);
+    free(fir->history);
+    fir->coefficients = NULL;
+    fir->history = NULL;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+#include "fft-parallel.h"
+
+/**
+ * @brief FAST_CONVOLUTION_MAX_FFT_SIZE is the largest FFT size. The forward
+ * FFT is not scaled, with samples below 1.0 a 2^14 point spectrum just fits
+ * in 32 bits.
+ */
+#define FAST_CONVOLUTION_MAX_FFT_SIZE (1 << 14)
+
+typedef enum {
+    FAST_CONVOLUTION_OVERLAP_SAVE,
+    FAST_CONVOLUTION_OVERLAP_ADD
+} FastConvolutionMethod;
+
+typedef struct {
+    FastConvolutionMethod method;
+    int32_t taps;
+    int32_t fft_size;
+    int32_t log2_fft_size;
+    int32_t filter_shift; /* guard bits of the filter spectrum */
+    int32_t block;       /* new samples per FFT, fft_size - taps + 1 */
+    int32_t fill;        /* samples in the current block */
+    Complex *filter;     /* the spectrum of the zero padded filter */
+    Complex *buffer;
+    int32_t *input;      /* overlap-save: taps - 1 old samples and the block */
+    int32_t *overlap;    /* overlap-add: the taps - 1 sample tail */
+    int32_t *output;     /* the output of the previous block */
+    FftFourStep *plan;
+} FastConvolution;
+
+int32_t fast_convolution_fft_size(int32_t taps);
+int32_t fast_convolution_init(FastConvolution *conv, const int32_t h[], int32_t taps,
+                              int32_t fft_size, FastConvolutionMethod method);
+int32_t fast_convolution_process(FastConvolution *conv, const int32_t in[], int32_t out[],
+                                 int32_t count);
+void fast_convolution_reset(FastConvolution *conv);
+void fast_convolution_free(FastConvolution *conv);
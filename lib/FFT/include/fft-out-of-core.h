@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief FFT_OUT_OF_CORE_MAX_LOG2 is the largest transform, 2^30 Complex
+ * values or 8 GiB. The row transforms then have 2^15 points, the
+ * most a full scale Q16 signal can grow by without overflowing.
+ */
+#define FFT_OUT_OF_CORE_MAX_LOG2 30
+
+int32_t fft_out_of_core(const char *input_path, const char *output_path, int64_t N,
+                        size_t memory, int32_t *exponent);
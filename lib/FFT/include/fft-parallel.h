@@ -0,0 +1,45 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+#include "thread-pool.h"
+
+/**
+ * @brief FFT_TRANSPOSE_TILE is the side of the square tiles the transposes
+ * work in, 32 x 32 Complex is 8 kB so a source and a destination tile fit
+ * in the L1 cache together.
+ */
+#define FFT_TRANSPOSE_TILE 32
+
+/**
+ * @brief Twiddle factors W_N^m for large N from two small tables,
+ * W_N^m = hi[m >> lo_bits] * lo[m & (2^lo_bits - 1)], so only about
+ * 2 * sqrt(N) values are stored.
+ */
+typedef struct {
+    int64_t N;
+    int32_t lo_bits;
+    Complex *lo;
+    Complex *hi;
+} FftTwiddleTable;
+
+typedef struct {
+    int32_t N;
+    int32_t N1;         /* length of the column transforms */
+    int32_t N2;         /* length of the row transforms */
+    ThreadPool *pool;
+    FftTwiddleTable twiddle;
+    Complex *work;
+} FftFourStep;
+
+int32_t fft_twiddle_table_init(FftTwiddleTable *table, int64_t N);
+Complex fft_twiddle_table_get(const FftTwiddleTable *table, int64_t m);
+void fft_twiddle_table_free(FftTwiddleTable *table);
+int32_t fft_transpose(const Complex in[], Complex out[], int32_t rows, int32_t cols,
+                      ThreadPool *pool);
+FftFourStep *fft_four_step_create(int32_t N, ThreadPool *pool);
+int32_t fft_four_step_execute(FftFourStep *plan, Complex x[]);
+void fft_four_step_destroy(FftFourStep *plan);
+int32_t fft2d(Complex x[], Complex work[], int32_t rows, int32_t cols, ThreadPool *pool);
+int32_t inverse_fft2d(Complex x[], Complex work[], int32_t rows, int32_t cols,
+                      ThreadPool *pool);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief FFT_SPECTRUM_DB_FLOOR is the level in dB given for bins with an
+ * amplitude of 0, fixedpoint according to FFT_MATH_FRACTION_BITS. One LSB
+ * of amplitude is about -96 dB.
+ */
+#define FFT_SPECTRUM_DB_FLOOR (-120 * (1 << FFT_MATH_FRACTION_BITS))
+
+typedef enum {
+    FFT_SPECTRUM_MAGNITUDE,       /* amplitude, 1/N at bin 0 and 2/N elsewhere */
+    FFT_SPECTRUM_POWER_DB,        /* 20*log10 of the amplitude */
+    FFT_SPECTRUM_MAGNITUDE_PHASE  /* amplitude and phase in degrees */
+} FftSpectrumMode;
+
+int32_t fft_spectrum_post(const Complex X[], int32_t N, int32_t bins, FftSpectrumMode mode,
+                          int32_t out[], int32_t phase[]);
+int32_t fft_spectrum(Complex x[], int32_t N, int32_t bins, FftSpectrumMode mode,
+                     int32_t out[], int32_t phase[]);
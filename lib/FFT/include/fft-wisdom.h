@@ -0,0 +1,23 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief FFT_WISDOM_MAX_ENTRIES is the number of transform lengths the
+ * wisdom can hold, one algorithm is stored per length.
+ */
+#define FFT_WISDOM_MAX_ENTRIES 64
+
+/**
+ * @brief FFT_WISDOM_MEASURE_MS is the time in milliseconds every candidate
+ * algorithm is run for when it is measured.
+ */
+#define FFT_WISDOM_MEASURE_MS 20
+
+int32_t fft_wisdom_lookup(int32_t N, FftAlgorithm *algorithm);
+int32_t fft_wisdom_measure(int32_t N, FftAlgorithm *algorithm);
+FftPlan *fft_plan_create_measured(int32_t N);
+int32_t fft_wisdom_load(const char *path);
+int32_t fft_wisdom_save(const char *path);
+void fft_wisdom_forget(void);
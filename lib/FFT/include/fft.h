@@ -4,12 +4,66 @@
 
 #define FFT_MATH_FRACTION_BITS 16
 
+/**
+ * @brief FFT_MAX_FACTORS is the largest number of radix 2, 3, 4, 5 and 7
+ * stages a mixed-radix plan can be split into.
+ */
+#define FFT_MAX_FACTORS 32
+
+/**
+ * @brief Arrays with at least FFT_BITREV_BLOCKED_MIN elements are bit reversal
+ * sorted in tiles of 2^FFT_BITREV_BLOCK_BITS x 2^FFT_BITREV_BLOCK_BITS elements
+ * to keep the swaps inside the cache. FFT_BITREV_BLOCKED_MIN must be at least
+ * 2^(2 * FFT_BITREV_BLOCK_BITS).
+ */
+#define FFT_BITREV_BLOCK_BITS 4
+#define FFT_BITREV_BLOCKED_MIN 4096
+
 typedef struct {
     int real;
     int imag;
 } Complex;
 
-static int32_t ones_32(int32_t n);
-static int32_t floor_log2_32(int32_t x);
+/**
+ * @brief Complex sample with 16 bit Q15 storage, half the size of Complex.
+ */
+typedef struct {
+    int16_t real;
+    int16_t imag;
+} ComplexQ15;
+
+/**
+ * @brief FFT_Q15_GROWTH_LIMIT is the largest magnitude a Q15 component may have
+ * before a radix-2 stage, a butterfly can grow a component by 1 + sqrt(2).
+ * Larger values make fft_q15() scale the stage output down.
+ */
+#define FFT_Q15_GROWTH_LIMIT 13500
+
+typedef enum {
+    FFT_ALGORITHM_RADIX_2,
+    FFT_ALGORITHM_MIXED_RADIX,
+    FFT_ALGORITHM_BLUESTEIN,
+    FFT_ALGORITHM_STOCKHAM
+} FftAlgorithm;
+
+typedef struct {
+    int32_t N;
+    FftAlgorithm algorithm;
+    int32_t factors[FFT_MAX_FACTORS];
+    int32_t num_factors;
+    Complex *twiddle;   /* W_N^k for k < N, mixed-radix only */
+    Complex *work;      /* N entries for mixed-radix and Stockham, 2M for Bluestein */
+    int32_t M;          /* Bluestein convolution length, power of two */
+    Complex *chirp;     /* exp(-i*pi*n^2/N) for n < N, Bluestein only */
+    Complex *chirp_fft; /* FFT of the conjugated chirp, Bluestein only */
+} FftPlan;
+
 int32_t fft(Complex x[], int32_t N);
-int32_t inverse_fft(Complex x[], int32_t N);
\ No newline at end of file
+int32_t inverse_fft(Complex x[], int32_t N);
+int32_t fft_stockham(Complex x[], Complex work[], int32_t N);
+int32_t fft_bit_reverse(Complex x[], int32_t N);
+int32_t fft_q15(ComplexQ15 x[], int32_t N, int32_t *exponent);
+FftPlan *fft_plan_create(int32_t N);
+FftPlan *fft_plan_create_algorithm(int32_t N, FftAlgorithm algorithm);
+int32_t fft_plan_execute(const FftPlan *plan, Complex x[]);
+void fft_plan_destroy(FftPlan *plan);
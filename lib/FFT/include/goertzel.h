@@ -0,0 +1,40 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief GOERTZEL_MAX_BINS is the largest number of frequencies one
+ * GoertzelBank can track, the state is stored inline so no memory is
+ * allocated.
+ */
+#define GOERTZEL_MAX_BINS 16
+/**
+ * @brief GOERTZEL_COEFFICIENT_BITS is the number of fraction bits of the
+ * filter coefficients. The recursion amplifies the coefficient rounding by
+ * about N, 16 bits give a phase error of tens of degrees at N = 512.
+ */
+#define GOERTZEL_COEFFICIENT_BITS 30
+
+/**
+ * @brief Called at the end of every block of N samples with the DFT value
+ * of every tracked bin, in the same order as the bins given to goertzel_init().
+ */
+typedef void (*GoertzelCallback)(const Complex bins[], int32_t num_bins, void *user);
+
+typedef struct {
+    int32_t N;
+    int32_t num_bins;
+    int32_t count;                        /* samples in the current block */
+    int32_t cos_w[GOERTZEL_MAX_BINS];     /* GOERTZEL_COEFFICIENT_BITS */
+    int32_t sin_w[GOERTZEL_MAX_BINS];
+    int64_t s1[GOERTZEL_MAX_BINS];
+    int64_t s2[GOERTZEL_MAX_BINS];
+    GoertzelCallback callback;
+    void *user;
+} GoertzelBank;
+
+int32_t goertzel_init(GoertzelBank *bank, int32_t N, const int32_t bins[],
+                      int32_t num_bins, GoertzelCallback callback, void *user);
+int32_t goertzel_push(GoertzelBank *bank, const int32_t samples[], int32_t count);
+void goertzel_reset(GoertzelBank *bank);
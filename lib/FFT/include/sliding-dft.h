@@ -0,0 +1,27 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief SLIDING_DFT_MAX_BINS is the largest number of frequencies one
+ * SlidingDft can track.
+ */
+#define SLIDING_DFT_MAX_BINS 16
+
+typedef struct {
+    int32_t N;
+    int32_t num_bins;
+    int32_t pos;                              /* index of the oldest sample in history */
+    int32_t bins[SLIDING_DFT_MAX_BINS];
+    int32_t phase[SLIDING_DFT_MAX_BINS];      /* bins[b] * pos modulo N */
+    int64_t acc_real[SLIDING_DFT_MAX_BINS];   /* FFT_MATH_FRACTION_BITS * 2 */
+    int64_t acc_imag[SLIDING_DFT_MAX_BINS];
+    int32_t *history;                         /* the last N samples, caller owned */
+    Complex *twiddle;                         /* W_N^t for t < N, caller owned */
+} SlidingDft;
+
+int32_t sliding_dft_init(SlidingDft *sdft, int32_t N, const int32_t bins[],
+                         int32_t num_bins, int32_t history[], Complex twiddle[]);
+int32_t sliding_dft_push(SlidingDft *sdft, const int32_t samples[], int32_t count);
+int32_t sliding_dft_bins(const SlidingDft *sdft, Complex out[]);
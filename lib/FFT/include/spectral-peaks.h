@@ -0,0 +1,29 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief SPECTRAL_PEAKS_MAX is the largest number of peaks that can be
+ * asked for at once.
+ */
+#define SPECTRAL_PEAKS_MAX 32
+
+typedef enum {
+    SPECTRAL_PEAKS_NONE,       /* the frequency is the bin itself */
+    SPECTRAL_PEAKS_QUADRATIC,  /* parabola through the three magnitudes */
+    SPECTRAL_PEAKS_JACOBSEN    /* Jacobsen's estimator on the complex bins */
+} SpectralPeakInterpolation;
+
+typedef struct {
+    int32_t bin;        /* the bin of the local maximum */
+    int32_t frequency;  /* in bins, fixedpoint according to FFT_MATH_FRACTION_BITS */
+    int32_t magnitude;  /* |X[bin]| */
+    int32_t phase;      /* of X[bin] in degrees, fixedpoint according to FFT_MATH_FRACTION_BITS */
+} SpectralPeak;
+
+int32_t spectral_peaks_find(const Complex X[], int32_t bins, int32_t threshold,
+                            int32_t max_peaks, SpectralPeakInterpolation interpolation,
+                            SpectralPeak peaks[]);
+int32_t spectral_peaks_vocoder(const Complex previous[], const Complex current[], int32_t N,
+                               int32_t hop, SpectralPeak peaks[], int32_t count);
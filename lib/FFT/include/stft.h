@@ -0,0 +1,37 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+typedef enum {
+    STFT_WINDOW_RECTANGULAR,
+    STFT_WINDOW_HANN,
+    STFT_WINDOW_HAMMING,
+    STFT_WINDOW_BLACKMAN
+} StftWindow;
+
+/**
+ * @brief Called once for every frame, frame holds the N bin spectrum of the
+ * windowed frame. The array belongs to the Stft and is reused for the next
+ * frame.
+ */
+typedef void (*StftFrameCallback)(const Complex frame[], int32_t N, void *user);
+
+typedef struct {
+    int32_t frame_size;
+    int32_t hop;
+    int32_t *window;     /* fixedpoint according to FFT_MATH_FRACTION_BITS */
+    int32_t *ring;       /* the last frame_size input samples */
+    int32_t write_pos;   /* index of the oldest sample in ring */
+    int32_t until_next;  /* samples left before the next frame is emitted */
+    Complex *frame;
+    FftPlan *plan;
+    StftFrameCallback callback;
+    void *user;
+} Stft;
+
+int32_t stft_init(Stft *stft, int32_t frame_size, int32_t hop, StftWindow window,
+                  StftFrameCallback callback, void *user);
+int32_t stft_push(Stft *stft, const int32_t samples[], int32_t count);
+void stft_reset(Stft *stft);
+void stft_free(Stft *stft);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief Processes the items [begin, end) of a parallel loop.
+ */
+typedef void (*ThreadPoolTask)(int32_t begin, int32_t end, void *ctx);
+
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool *thread_pool_create(int32_t threads);
+int32_t thread_pool_size(const ThreadPool *pool);
+int32_t thread_pool_parallel_for(ThreadPool *pool, int32_t count, int32_t grain,
+                                 ThreadPoolTask task, void *ctx);
+void thread_pool_destroy(ThreadPool *pool);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "stdint.h"
+#include "fft.h"
+
+/**
+ * @brief XCORR_MAX_LENGTH is the longest signal, the transforms are then
+ * 2^14 points and the cross spectrum of full scale signals still fits in
+ * 64 bits.
+ */
+#define XCORR_MAX_LENGTH 8192
+
+typedef enum {
+    XCORR_WEIGHT_NONE,  /* plain cross-correlation */
+    XCORR_WEIGHT_PHAT   /* GCC-PHAT, only the phase of the cross spectrum is kept */
+} XcorrWeighting;
+
+typedef struct {
+    int32_t length;      /* samples per signal */
+    int32_t N;           /* FFT size, at least 2 * length so the lags do not wrap */
+    int32_t log2_N;
+    XcorrWeighting weighting;
+    Complex *reference;  /* conjugated spectrum of the reference signal */
+    Complex *spectrum;
+    Complex *cross;
+} Xcorr;
+
+int32_t xcorr_init(Xcorr *xc, int32_t length, XcorrWeighting weighting);
+int32_t xcorr_set_reference(Xcorr *xc, const int32_t reference[]);
+int32_t xcorr_correlate(Xcorr *xc, const int32_t signal[], int32_t correlation[]);
+int32_t xcorr_delays(Xcorr *xc, const int32_t *const signals[], int32_t count,
+                     int32_t max_lag, int32_t delays[]);
+int32_t xcorr_pair_delay(Xcorr *xc, const int32_t a[], const int32_t b[], int32_t max_lag,
+                         int32_t *delay);
+void xcorr_free(Xcorr *xc);
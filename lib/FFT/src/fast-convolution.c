@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fast-convolution.h"
+
+/**
+ * @brief Picks the FFT size with the lowest cost per output sample for a
+ * filter with the given number of taps. Every block costs a forward and an
+ * inverse FFT, about 2 * N * log2(N), and N complex multiplications, and
+ * gives N - taps + 1 output samples.
+ *
+ * @param taps the filter length, taps >= 1.
+ *
+ * @return The FFT size, a number 2^k, 0 if the filter is too long for
+ * FAST_CONVOLUTION_MAX_FFT_SIZE.
+ */
+int32_t fast_convolution_fft_size(int32_t taps) {
+    int32_t best = 0;
+    int64_t best_cost = 0;
+
+    for (int32_t bits = 2; (1 << bits) <= FAST_CONVOLUTION_MAX_FFT_SIZE; bits++) {
+        int32_t N = 1 << bits;
+        int64_t block = N - taps + 1;
+        int64_t cost;
+
+        if (block < 1) {
+            continue;
+        }
+        /* Scaled by 1024 so the integer division keeps enough resolution */
+        cost = ((int64_t)N * (2 * bits + 4) << 10) / block;
+        /* A larger block adds latency and leaves the cache, so it has to be
+         * clearly cheaper on paper */
+        if (best == 0 || cost * 16 < best_cost * 15) {
+            best = N;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Filters one block, the real part of buffer holds the input and
+ * holds the circular convolution with the filter afterwards. The inverse
+ * FFT is done as conj(FFT(conj(X))). The product keeps every bit above the
+ * fraction bits, it is only scaled down by a block exponent when the sum
+ * of its magnitudes, the bound for every value inside the inverse FFT,
+ * would not fit in 32 bits. The 1/N is a rounding shift after the inverse.
+ */
+static void filter_block(FastConvolution *conv) {
+    Complex *x = conv->buffer;
+    const Complex *H = conv->filter;
+    int32_t shift = FFT_MATH_FRACTION_BITS + conv->filter_shift;
+    int32_t exponent = 0;
+    int64_t norm = 0;
+    int64_t round;
+
+    fft_four_step_execute(conv->plan, x);
+    for (int32_t k = 0; k < conv->fft_size; k++) {
+        int64_t re = (int64_t)x[k].real * H[k].real - (int64_t)x[k].imag * H[k].imag;
+        int64_t im = (int64_t)x[k].real * H[k].imag + (int64_t)x[k].imag * H[k].real;
+        norm += ((re < 0 ? -re : re) >> shift) + ((im < 0 ? -im : im) >> shift);
+    }
+    /* One bit of the 32 stays free for the rounding of the twiddle
+     * factors, more than 1/N is never needed */
+    while ((norm >> exponent) >= (1 << 30) && exponent < conv->log2_fft_size) {
+        exponent++;
+    }
+    shift += exponent;
+    round = (int64_t)1 << (shift - 1);
+    for (int32_t k = 0; k < conv->fft_size; k++) {
+        int64_t re = (int64_t)x[k].real * H[k].real - (int64_t)x[k].imag * H[k].imag;
+        int64_t im = (int64_t)x[k].real * H[k].imag + (int64_t)x[k].imag * H[k].real;
+        x[k].real = (int)((re + round) >> shift);
+        x[k].imag = (int)((-im + round) >> shift);
+    }
+    /* Only the real part of the result is used, it needs no conjugation */
+    fft_four_step_execute(conv->plan, x);
+
+    shift = conv->log2_fft_size - exponent;
+    if (shift > 0) {
+        int32_t half = 1 << (shift - 1);
+        for (int32_t n = 0; n < conv->fft_size; n++) {
+            x[n].real = (int)(((int64_t)x[n].real + half) >> shift);
+        }
+    }
+}
+
+/**
+ * @brief Overlap-save, the FFT runs over the taps - 1 previous samples and
+ * the new block, the first taps - 1 results are wrapped around and dropped.
+ */
+static void overlap_save_block(FastConvolution *conv) {
+    int32_t history = conv->taps - 1;
+
+    for (int32_t n = 0; n < conv->fft_size; n++) {
+        conv->buffer[n].real = conv->input[n];
+        conv->buffer[n].imag = 0;
+    }
+    filter_block(conv);
+    for (int32_t n = 0; n < conv->block; n++) {
+        conv->output[n] = conv->buffer[history + n].real;
+    }
+    memmove(conv->input, &conv->input[conv->block], sizeof(int32_t) * history);
+}
+
+/**
+ * @brief Overlap-add, the block is zero padded so the full linear
+ * convolution fits, the tail is added to the following blocks.
+ */
+static void overlap_add_block(FastConvolution *conv) {
+    int32_t tail = conv->taps - 1;
+    int32_t L = conv->block;
+
+    for (int32_t n = 0; n < L; n++) {
+        conv->buffer[n].real = conv->input[n];
+        conv->buffer[n].imag = 0;
+    }
+    memset(&conv->buffer[L], 0, sizeof(Complex) * tail);
+    filter_block(conv);
+
+    for (int32_t n = 0; n < L; n++) {
+        conv->output[n] = conv->buffer[n].real + (n < tail ? conv->overlap[n] : 0);
+    }
+    /* The tail can be longer than a block when the filter is long */
+    for (int32_t n = 0; n < tail; n++) {
+        conv->overlap[n] = conv->buffer[L + n].real + (L + n < tail ? conv->overlap[L + n] : 0);
+    }
+}
+
+/**
+ * @brief Sets up a streaming FIR filter that runs as a fast convolution.
+ * The spectrum of the filter is calculated once, every block of new
+ * samples then costs one forward FFT, a complex multiplication per bin and
+ * one inverse FFT. The transforms use the four-step FFT, which stays
+ * accurate for the long transforms long filters need.
+ *
+ * @param conv the FastConvolution to set up.
+ * @param h the filter taps, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ * @param taps the number of taps.
+ * @param fft_size the FFT size, a number 2^k > taps, 0 picks the size with
+ * fast_convolution_fft_size().
+ * @param method overlap-save or overlap-add, the output is the same.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t fast_convolution_init(FastConvolution *conv, const int32_t h[], int32_t taps,
+                              int32_t fft_size, FastConvolutionMethod method) {
+    int64_t sum = 0;
+
+    memset(conv, 0, sizeof(FastConvolution));
+    if (taps < 1) {
+        return -1;
+    }
+    if (fft_size == 0) {
+        fft_size = fast_convolution_fft_size(taps);
+    }
+    if (fft_size < 4 || fft_size <= taps || (fft_size & (fft_size - 1)) != 0) {
+        return -1;
+    }
+    conv->method = method;
+    conv->taps = taps;
+    conv->fft_size = fft_size;
+    while ((1 << conv->log2_fft_size) < fft_size) {
+        conv->log2_fft_size++;
+    }
+    conv->block = fft_size - taps + 1;
+    conv->filter = malloc(sizeof(Complex) * fft_size);
+    conv->buffer = malloc(sizeof(Complex) * fft_size);
+    conv->input = malloc(sizeof(int32_t) * fft_size);
+    conv->overlap = malloc(sizeof(int32_t) * taps);
+    conv->output = malloc(sizeof(int32_t) * conv->block);
+    conv->plan = fft_four_step_create(fft_size, NULL);
+    if (conv->filter == NULL || conv->buffer == NULL || conv->input == NULL ||
+        conv->overlap == NULL || conv->output == NULL || conv->plan == NULL) {
+        fast_convolution_free(conv);
+        return -1;
+    }
+
+    /* The spectrum of the filter is at most the sum of its magnitudes, the
+     * rest of 30 bits become guard bits so the rounding inside the FFT
+     * does not cost the short taps of long filters their precision */
+    for (int32_t n = 0; n < taps; n++) {
+        sum += h[n] < 0 ? -(int64_t)h[n] : h[n];
+    }
+    while (sum > 0 && (sum << (conv->filter_shift + 1)) < (1 << 30)) {
+        conv->filter_shift++;
+    }
+    for (int32_t n = 0; n < fft_size; n++) {
+        conv->filter[n].real = n < taps ? h[n] * (1 << conv->filter_shift) : 0;
+        conv->filter[n].imag = 0;
+    }
+    fft_four_step_execute(conv->plan, conv->filter);
+    fast_convolution_reset(conv);
+    return 0;
+}
+
+/**
+ * @brief Filters a stream of samples. The output is delayed by exactly one
+ * block, out[i] belongs to the input block samples earlier, so every call
+ * gives exactly count output samples.
+ *
+ * @param conv the FastConvolution.
+ * @param in fixedpoint samples according to FFT_MATH_FRACTION_BITS.
+ * @param out the filtered samples, may be the same array as in.
+ * @param count the number of samples, any size.
+ *
+ * @return The number of blocks processed.
+ */
+int32_t fast_convolution_process(FastConvolution *conv, const int32_t in[], int32_t out[],
+                                 int32_t count) {
+    int32_t blocks = 0;
+    int32_t offset = conv->method == FAST_CONVOLUTION_OVERLAP_SAVE ? conv->taps - 1 : 0;
+
+    while (count > 0) {
+        int32_t n = conv->block - conv->fill;
+        if (n > count) {
+            n = count;
+        }
+        /* Read before write so in and out can be the same array */
+        for (int32_t i = 0; i < n; i++) {
+            int32_t sample = in[i];
+            out[i] = conv->output[conv->fill + i];
+            conv->input[offset + conv->fill + i] = sample;
+        }
+        in += n;
+        out += n;
+        count -= n;
+        conv->fill += n;
+
+        if (conv->fill == conv->block) {
+            if (conv->method == FAST_CONVOLUTION_OVERLAP_SAVE) {
+                overlap_save_block(conv);
+            } else {
+                overlap_add_block(conv);
+            }
+            conv->fill = 0;
+            blocks++;
+        }
+    }
+    return blocks;
+}
+
+/**
+ * @brief Clears the filter state, the filter spectrum is kept.
+ */
+void fast_convolution_reset(FastConvolution *conv) {
+    conv->fill = 0;
+    memset(conv->input, 0, sizeof(int32_t) * conv->fft_size);
+    memset(conv->overlap, 0, sizeof(int32_t) * conv->taps);
+    memset(conv->output, 0, sizeof(int32_t) * conv->block);
+}
+
+/**
+ * @brief Frees the memory allocated by fast_convolution_init().
+ */
+void fast_convolution_free(FastConvolution *conv) {
+    free(conv->filter);
+    free(conv->buffer);
+    free(conv->input);
+    free(conv->overlap);
+    free(conv->output);
+    fft_four_step_destroy(conv->plan);
+    conv->filter = NULL;
+    conv->buffer = NULL;
+    conv->input = NULL;
+    conv->overlap = NULL;
+    conv->output = NULL;
+    conv->plan = NULL;
+}
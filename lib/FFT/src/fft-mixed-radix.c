@@ -0,0 +1,404 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft.h"
+#include "fft-wisdom.h"
+#include "cordic-math.h"
+
+#if FFT_MATH_FRACTION_BITS >= CORDIC_MATH_FRACTION_BITS
+#define CORDIC_TO_FFT(x) ((x) << (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#else
+#define CORDIC_TO_FFT(x) ((x) >> (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#endif
+
+/**
+ * @brief Calculates the twiddle factor exp(-2*pi*i*k/N) with the cordic
+ * algorithm.
+ *
+ * @param k the index of the twiddle factor, 0 <= k < N.
+ * @param N the length of the transform.
+ * @param w pointer where the fixedpoint twiddle factor is stored.
+ */
+static void twiddle_factor(int64_t k, int64_t N, Complex *w) {
+    int32_t s, c;
+    int32_t theta = (int32_t)((k * (360 << CORDIC_MATH_FRACTION_BITS)) / N);
+
+    cordic_sincos(theta, &s, &c);
+    w->real = CORDIC_TO_FFT(c);
+    w->imag = -CORDIC_TO_FFT(s);
+}
+
+/**
+ * @brief Fixedpoint complex multiplication a*b.
+ */
+static inline Complex complex_mul(Complex a, Complex b) {
+    Complex r;
+    r.real = (int)(((int64_t)a.real * b.real - (int64_t)a.imag * b.imag) >>
+                   FFT_MATH_FRACTION_BITS);
+    r.imag = (int)(((int64_t)a.real * b.imag + (int64_t)a.imag * b.real) >>
+                   FFT_MATH_FRACTION_BITS);
+    return r;
+}
+
+/**
+ * @brief Returns non zero if N is a power of two.
+ */
+static int32_t is_power_of_two(int32_t N) {
+    return N > 0 && (N & (N - 1)) == 0;
+}
+
+/**
+ * @brief Splits N into radix 4, 2, 3, 5 and 7 factors.
+ *
+ * @return The part of N that could not be factorized, 1 if N is 7-smooth.
+ */
+static int32_t factorize(int32_t N, int32_t factors[], int32_t *num_factors) {
+    static const int32_t radices[] = {4, 2, 3, 5, 7};
+    int32_t n = 0;
+
+    for (int32_t r = 0; r < (int32_t)(sizeof(radices) / sizeof(radices[0])); r++) {
+        while (N % radices[r] == 0 && n < FFT_MAX_FACTORS) {
+            factors[n++] = radices[r];
+            N /= radices[r];
+        }
+    }
+    *num_factors = n;
+    return N;
+}
+
+/**
+ * @brief One Stockham autosort pass of a radix p decimation in frequency
+ * FFT, reads src and writes dst.
+ *
+ * @param n the length of the sub transforms in this pass.
+ * @param s the stride, the number of interleaved sub transforms.
+ * @param p the radix of this pass, 2, 3, 4, 5 or 7.
+ * @param twiddle table of W_N^k for the full transform length N.
+ */
+static void mixed_radix_pass(const Complex src[], Complex dst[], int32_t n,
+                             int32_t s, int32_t p, const Complex twiddle[],
+                             int32_t N) {
+    Complex a[7], b[7];
+    int32_t m = n / p;
+    int32_t tw_stride = N / n;
+    int32_t root_stride = N / p;
+
+    for (int32_t q = 0; q < m; q++) {
+        for (int32_t k = 0; k < s; k++) {
+            for (int32_t r = 0; r < p; r++) {
+                a[r] = src[s * (q + r * m) + k];
+            }
+
+            if (p == 2) {
+                b[0].real = a[0].real + a[1].real;
+                b[0].imag = a[0].imag + a[1].imag;
+                b[1].real = a[0].real - a[1].real;
+                b[1].imag = a[0].imag - a[1].imag;
+            } else if (p == 4) {
+                int t0r = a[0].real + a[2].real, t0i = a[0].imag + a[2].imag;
+                int t1r = a[0].real - a[2].real, t1i = a[0].imag - a[2].imag;
+                int t2r = a[1].real + a[3].real, t2i = a[1].imag + a[3].imag;
+                int t3r = a[1].real - a[3].real, t3i = a[1].imag - a[3].imag;
+                b[0].real = t0r + t2r;
+                b[0].imag = t0i + t2i;
+                b[1].real = t1r + t3i; /* t1 - i*t3 */
+                b[1].imag = t1i - t3r;
+                b[2].real = t0r - t2r;
+                b[2].imag = t0i - t2i;
+                b[3].real = t1r - t3i; /* t1 + i*t3 */
+                b[3].imag = t1i + t3r;
+            } else {
+                /*
+                 * Odd prime radix, pairs a[r] and a[p-r] so that every
+                 * root of unity is only multiplied once per pair.
+                 */
+                int64_t sum_r = a[0].real, sum_i = a[0].imag;
+                for (int32_t r = 1; r < p; r++) {
+                    sum_r += a[r].real;
+                    sum_i += a[r].imag;
+                }
+                b[0].real = (int)sum_r;
+                b[0].imag = (int)sum_i;
+
+                for (int32_t j = 1; j <= p / 2; j++) {
+                    int64_t ar = 0, ai = 0, br = 0, bi = 0;
+                    for (int32_t r = 1; r <= p / 2; r++) {
+                        const Complex *w = &twiddle[((j * r) % p) * root_stride];
+                        int64_t ur = a[r].real + a[p - r].real;
+                        int64_t ui = a[r].imag + a[p - r].imag;
+                        int64_t vr = a[r].real - a[p - r].real;
+                        int64_t vi = a[r].imag - a[p - r].imag;
+                        /* w = cos - i*sin */
+                        ar += ur * w->real;
+                        ai += ui * w->real;
+                        br -= vr * w->imag;
+                        bi -= vi * w->imag;
+                    }
+                    ar = a[0].real + (ar >> FFT_MATH_FRACTION_BITS);
+                    ai = a[0].imag + (ai >> FFT_MATH_FRACTION_BITS);
+                    br >>= FFT_MATH_FRACTION_BITS;
+                    bi >>= FFT_MATH_FRACTION_BITS;
+                    /* b[j] = A - i*B, b[p-j] = A + i*B */
+                    b[j].real = (int)(ar + bi);
+                    b[j].imag = (int)(ai - br);
+                    b[p - j].real = (int)(ar - bi);
+                    b[p - j].imag = (int)(ai + br);
+                }
+            }
+
+            dst[s * (p * q) + k] = b[0];
+            for (int32_t j = 1; j < p; j++) {
+                dst[s * (p * q + j) + k] =
+                    complex_mul(b[j], twiddle[j * q * tw_stride]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Mixed-radix FFT of length n for 7-smooth lengths, ping-pongs
+ * between x and work and leaves the answer in x.
+ */
+static void fft_mixed_radix(Complex x[], Complex work[], int32_t n,
+                            const int32_t factors[], int32_t num_factors,
+                            const Complex twiddle[]) {
+    Complex *src = x, *dst = work, *tmp;
+    int32_t N = n, s = 1;
+
+    for (int32_t f = 0; f < num_factors; f++) {
+        int32_t p = factors[f];
+        mixed_radix_pass(src, dst, n, s, p, twiddle, N);
+        n /= p;
+        s *= p;
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != x) {
+        memcpy(x, src, sizeof(Complex) * N);
+    }
+}
+
+/**
+ * @brief Bluestein chirp-z FFT for arbitrary lengths, the DFT is
+ * rewritten as a convolution of length M = 2^k which is computed with
+ * the table driven mixed-radix passes.
+ */
+static void fft_bluestein(const FftPlan *plan, Complex x[]) {
+    Complex *a = plan->work;
+    Complex *work = &plan->work[plan->M];
+    int32_t M = plan->M;
+    int32_t shift = FFT_MATH_FRACTION_BITS;
+
+    for (int32_t m = M; m > 1; m >>= 1) {
+        shift++;
+    }
+
+    for (int32_t n = 0; n < plan->N; n++) {
+        a[n] = complex_mul(x[n], plan->chirp[n]);
+    }
+    memset(&a[plan->N], 0, sizeof(Complex) * (M - plan->N));
+
+    fft_mixed_radix(a, work, M, plan->factors, plan->num_factors, plan->twiddle);
+
+    /*
+     * Pointwise product with the chirp spectrum, the 1/M of the inverse
+     * transform is folded into the shift and the result is conjugated so
+     * the inverse can be computed with the forward transform.
+     */
+    for (int32_t k = 0; k < M; k++) {
+        const Complex *b = &plan->chirp_fft[k];
+        int64_t re = (int64_t)a[k].real * b->real - (int64_t)a[k].imag * b->imag;
+        int64_t im = (int64_t)a[k].real * b->imag + (int64_t)a[k].imag * b->real;
+        a[k].real = (int)(re >> shift);
+        a[k].imag = -(int)(im >> shift);
+    }
+
+    fft_mixed_radix(a, work, M, plan->factors, plan->num_factors, plan->twiddle);
+
+    for (int32_t k = 0; k < plan->N; k++) {
+        Complex c = {a[k].real, -a[k].imag};
+        x[k] = complex_mul(c, plan->chirp[k]);
+    }
+}
+
+/**
+ * @brief Creates a plan for a Fast Fourier Transform of any length.
+ * Without wisdom for N, powers of two use fft(), lengths made up of the
+ * factors 2, 3, 5 and 7 use mixed-radix kernels and every other length
+ * falls back to the Bluestein chirp-z algorithm. When fft-wisdom.h has an
+ * entry for N, the algorithm measured fastest on this host is used
+ * instead. The twiddle factors are calculated once with the cordic
+ * algorithm when the plan is created.
+ *
+ * @param N is the length of the transform, N >= 1.
+ *
+ * @return Pointer to the plan, NULL if N is invalid or if the memory
+ * could not be allocated. Free the plan with fft_plan_destroy().
+ */
+FftPlan *fft_plan_create(int32_t N) {
+    FftAlgorithm algorithm;
+    FftPlan *plan;
+    int32_t factors[FFT_MAX_FACTORS], num_factors;
+
+    if (N < 1) {
+        return NULL;
+    }
+    if (fft_wisdom_lookup(N, &algorithm) == 0) {
+        plan = fft_plan_create_algorithm(N, algorithm);
+        if (plan != NULL) {
+            return plan;
+        }
+    }
+
+    if (is_power_of_two(N)) {
+        algorithm = FFT_ALGORITHM_RADIX_2;
+    } else if (factorize(N, factors, &num_factors) == 1) {
+        algorithm = FFT_ALGORITHM_MIXED_RADIX;
+    } else {
+        algorithm = FFT_ALGORITHM_BLUESTEIN;
+    }
+    return fft_plan_create_algorithm(N, algorithm);
+}
+
+/**
+ * @brief Creates a plan that uses the given algorithm.
+ *
+ * @param N is the length of the transform, N >= 1.
+ * @param algorithm the algorithm. FFT_ALGORITHM_RADIX_2 and
+ * FFT_ALGORITHM_STOCKHAM need a power of two, FFT_ALGORITHM_MIXED_RADIX
+ * needs a length made up of the factors 2, 3, 5 and 7, Bluestein takes
+ * any length.
+ *
+ * @return Pointer to the plan, NULL if the algorithm can not do N or if the
+ * memory could not be allocated. Free the plan with fft_plan_destroy().
+ */
+FftPlan *fft_plan_create_algorithm(int32_t N, FftAlgorithm algorithm) {
+    FftPlan *plan;
+
+    if (N < 1) {
+        return NULL;
+    }
+    plan = calloc(1, sizeof(FftPlan));
+    if (plan == NULL) {
+        return NULL;
+    }
+    plan->N = N;
+    plan->algorithm = algorithm;
+
+    switch (algorithm) {
+    case FFT_ALGORITHM_RADIX_2:
+        if (!is_power_of_two(N)) {
+            break;
+        }
+        return plan;
+
+    case FFT_ALGORITHM_STOCKHAM:
+        if (!is_power_of_two(N)) {
+            break;
+        }
+        plan->work = malloc(sizeof(Complex) * N);
+        if (plan->work == NULL) {
+            break;
+        }
+        return plan;
+
+    case FFT_ALGORITHM_MIXED_RADIX:
+        if (factorize(N, plan->factors, &plan->num_factors) != 1) {
+            break;
+        }
+        plan->twiddle = malloc(sizeof(Complex) * N);
+        plan->work = malloc(sizeof(Complex) * N);
+        if (plan->twiddle == NULL || plan->work == NULL) {
+            break;
+        }
+        for (int32_t k = 0; k < N; k++) {
+            twiddle_factor(k, N, &plan->twiddle[k]);
+        }
+        return plan;
+
+    case FFT_ALGORITHM_BLUESTEIN:
+        plan->M = 1;
+        while (plan->M < 2 * N - 1) {
+            plan->M <<= 1;
+        }
+        factorize(plan->M, plan->factors, &plan->num_factors);
+        plan->twiddle = malloc(sizeof(Complex) * plan->M);
+        plan->chirp = malloc(sizeof(Complex) * N);
+        plan->chirp_fft = calloc(plan->M, sizeof(Complex));
+        plan->work = malloc(sizeof(Complex) * 2 * plan->M);
+        if (plan->twiddle == NULL || plan->chirp == NULL ||
+            plan->chirp_fft == NULL || plan->work == NULL) {
+            break;
+        }
+        for (int32_t k = 0; k < plan->M; k++) {
+            twiddle_factor(k, plan->M, &plan->twiddle[k]);
+        }
+        for (int32_t n = 0; n < N; n++) {
+            /* exp(-i*pi*n^2/N) = W_2N^(n^2), n^2 is reduced to keep the angle exact */
+            twiddle_factor(((int64_t)n * n) % (2 * (int64_t)N), 2 * (int64_t)N,
+                           &plan->chirp[n]);
+        }
+        plan->chirp_fft[0].real = plan->chirp[0].real;
+        plan->chirp_fft[0].imag = -plan->chirp[0].imag;
+        for (int32_t n = 1; n < N; n++) {
+            plan->chirp_fft[n].real = plan->chirp[n].real;
+            plan->chirp_fft[n].imag = -plan->chirp[n].imag;
+            plan->chirp_fft[plan->M - n] = plan->chirp_fft[n];
+        }
+        fft_mixed_radix(plan->chirp_fft, plan->work, plan->M, plan->factors,
+                        plan->num_factors, plan->twiddle);
+        return plan;
+    }
+
+    fft_plan_destroy(plan);
+    return NULL;
+}
+
+/**
+ * @brief Fast Fourier Transform of any length using a plan created by
+ * fft_plan_create().
+ *
+ * @param plan the plan for the length of x.
+ *
+ * @param x is a fixedpoint array of the complex datatype defined in fft.h,
+ * the answer of the FFT will be in this array. The data in this
+ * array will be deleted, make sure to save the data if you need it.
+ *
+ * @return The function returns 0, -1 if plan is NULL.
+ */
+int32_t fft_plan_execute(const FftPlan *plan, Complex x[]) {
+    if (plan == NULL) {
+        return -1;
+    }
+    switch (plan->algorithm) {
+    case FFT_ALGORITHM_RADIX_2:
+        return fft(x, plan->N);
+    case FFT_ALGORITHM_STOCKHAM:
+        return fft_stockham(x, plan->work, plan->N);
+    case FFT_ALGORITHM_MIXED_RADIX:
+        fft_mixed_radix(x, plan->work, plan->N, plan->factors,
+                        plan->num_factors, plan->twiddle);
+        break;
+    case FFT_ALGORITHM_BLUESTEIN:
+        fft_bluestein(plan, x);
+        break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Frees a plan created by fft_plan_create().
+ *
+ * @param plan the plan, NULL is allowed.
+ */
+void fft_plan_destroy(FftPlan *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    free(plan->twiddle);
+    free(plan->work);
+    free(plan->chirp);
+    free(plan->chirp_fft);
+    free(plan);
+}
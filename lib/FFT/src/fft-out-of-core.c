@@ -0,0 +1,281 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fft-out-of-core.h"
+#include "fft-parallel.h"
+
+/*
+ * Six step FFT. The file is seen as an N1 x N2 matrix, x[n1][n2] =
+ * x[N2*n1 + n2], N1 <= N2. The output file is twice as long while the
+ * transform runs, its first half A and its second half B hold the
+ * intermediate matrices:
+ *
+ * 1. The input is transposed into A, N2 x N1.
+ * 2. The rows of A get the length N1 transforms over n1, are multiplied
+ *    with W_N^(n2*k1) and scaled, in place.
+ * 3. A is transposed into B, N1 x N2.
+ * 4. The rows of B get the length N2 transforms over n2, in place. Element
+ *    [k1][k2] is then X[k1 + N1*k2].
+ * 5. B is transposed into A, which holds the natural order afterwards, and
+ *    the file is cut back to N values.
+ *
+ * The transforms run on whole rows, so steps 2 and 4 stream through the
+ * file. The transposes go through b x b tiles in memory and touch the file
+ * in runs of b values, at least a page when the budget is 2 MiB or more.
+ * Each page of the source and the destination is touched once per
+ * transpose.
+ */
+typedef struct {
+    int64_t N1;
+    int64_t N2;
+    int64_t block;       /* b, the side of a transpose tile */
+    int32_t shift;       /* scaling of step 2 */
+    Complex *tile;       /* b x b values */
+    FftPlan *plan1;
+    FftPlan *plan2;
+    FftTwiddleTable twiddle;
+} OutOfCore;
+
+/**
+ * @brief Maps a file into memory.
+ *
+ * @return The mapping, NULL on failure.
+ */
+static Complex *map_file(int fd, int64_t N, int writable) {
+    void *p = mmap(NULL, (size_t)N * sizeof(Complex),
+                   writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * @brief madvise() for a range that does not have to start on a page.
+ */
+static void advise(const void *start, size_t bytes, int advice) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t offset = (uintptr_t)start % page;
+
+    madvise((char *)start - offset, bytes + offset, advice);
+}
+
+/**
+ * @brief Starts the write back of a written range, so dirty pages do not
+ * pile up in memory while the pass goes on.
+ */
+static void flush(void *start, size_t bytes) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t offset = (uintptr_t)start % page;
+
+    msync((char *)start - offset, bytes + offset, MS_ASYNC);
+}
+
+/**
+ * @brief Transposes the rows x columns matrix src into dst. The tiles are
+ * taken column by column of src, so every stripe of b rows of dst is
+ * written in one go and flushed. The b runs of a tile are requested from
+ * the file before they are read, readahead beyond a run would fetch data
+ * of tiles that are only read much later.
+ */
+static void transpose(OutOfCore *ooc, const Complex src[], Complex dst[], int64_t rows,
+                      int64_t columns) {
+    int64_t b = ooc->block;
+
+    advise(src, sizeof(Complex) * rows * columns, MADV_RANDOM);
+    for (int64_t j0 = 0; j0 < columns; j0 += b) {
+        for (int64_t i0 = 0; i0 < rows; i0 += b) {
+            for (int64_t i = 0; i < b; i++) {
+                advise(&src[(i0 + i) * columns + j0], sizeof(Complex) * b, MADV_WILLNEED);
+            }
+            for (int64_t i = 0; i < b; i++) {
+                const Complex *run = &src[(i0 + i) * columns + j0];
+                for (int64_t j = 0; j < b; j++) {
+                    ooc->tile[j * b + i] = run[j];
+                }
+            }
+            for (int64_t j = 0; j < b; j++) {
+                memcpy(&dst[(j0 + j) * rows + i0], &ooc->tile[j * b], sizeof(Complex) * b);
+            }
+        }
+        flush(&dst[j0 * rows], sizeof(Complex) * b * rows);
+    }
+}
+
+/**
+ * @brief Transforms the rows of a matrix in place. With twiddle set, every
+ * value is multiplied with W_N^(row*column) and scaled by 2^-shift. The
+ * rows are flushed in groups of about a tile.
+ */
+static void transform_rows(OutOfCore *ooc, Complex data[], int64_t rows, int64_t length,
+                           const FftPlan *plan, int32_t twiddle) {
+    int64_t round = ooc->shift > 0 ? (int64_t)1 << (ooc->shift - 1) : 0;
+    int64_t group = ooc->block * ooc->block / length;
+
+    if (group < 1) {
+        group = 1;
+    }
+    advise(data, sizeof(Complex) * rows * length, MADV_SEQUENTIAL);
+    for (int64_t r0 = 0; r0 < rows; r0 += group) {
+        int64_t n = rows - r0 < group ? rows - r0 : group;
+
+        for (int64_t r = r0; r < r0 + n; r++) {
+            Complex *row = &data[r * length];
+            fft_plan_execute(plan, row);
+            if (!twiddle) {
+                continue;
+            }
+            for (int64_t k = 0; k < length; k++) {
+                Complex w = fft_twiddle_table_get(&ooc->twiddle, r * k);
+                int64_t re = (int64_t)row[k].real * w.real - (int64_t)row[k].imag * w.imag;
+                int64_t im = (int64_t)row[k].real * w.imag + (int64_t)row[k].imag * w.real;
+                row[k].real = (int)(((re >> FFT_MATH_FRACTION_BITS) + round) >> ooc->shift);
+                row[k].imag = (int)(((im >> FFT_MATH_FRACTION_BITS) + round) >> ooc->shift);
+            }
+        }
+        flush(&data[r0 * length], sizeof(Complex) * n * length);
+    }
+}
+
+/**
+ * @brief Frees the buffers and plans of out_of_core_init().
+ */
+static void out_of_core_free(OutOfCore *ooc) {
+    fft_twiddle_table_free(&ooc->twiddle);
+    fft_plan_destroy(ooc->plan1);
+    fft_plan_destroy(ooc->plan2);
+    free(ooc->tile);
+    ooc->plan1 = NULL;
+    ooc->plan2 = NULL;
+    ooc->tile = NULL;
+}
+
+/**
+ * @brief Splits N into N1 x N2, sizes the transpose tiles to the memory
+ * budget and allocates the buffers and plans.
+ *
+ * @return 0 on success, -1 if the budget does not hold a tile with runs of
+ * a page or the memory could not be allocated.
+ */
+static int32_t out_of_core_init(OutOfCore *ooc, int64_t N, size_t memory) {
+    int64_t page = sysconf(_SC_PAGESIZE) / (int64_t)sizeof(Complex);
+    int32_t bits = 0;
+
+    memset(ooc, 0, sizeof(OutOfCore));
+    while (((int64_t)1 << bits) < N) {
+        bits++;
+    }
+    ooc->N1 = (int64_t)1 << (bits / 2);
+    ooc->N2 = N / ooc->N1;
+    ooc->shift = bits > 15 ? bits - 15 : 0;
+
+    /* The largest power of two tile that fits the budget, at least one
+     * with runs of a page unless the matrix is narrower */
+    ooc->block = page < ooc->N1 ? page : ooc->N1;
+    if ((size_t)(ooc->block * ooc->block) * sizeof(Complex) > memory) {
+        return -1;
+    }
+    while (ooc->block < ooc->N1 &&
+           (size_t)(4 * ooc->block * ooc->block) * sizeof(Complex) <= memory) {
+        ooc->block *= 2;
+    }
+
+    ooc->tile = malloc(sizeof(Complex) * ooc->block * ooc->block);
+    ooc->plan1 = fft_plan_create_algorithm((int32_t)ooc->N1, FFT_ALGORITHM_MIXED_RADIX);
+    ooc->plan2 = fft_plan_create_algorithm((int32_t)ooc->N2, FFT_ALGORITHM_MIXED_RADIX);
+    if (ooc->tile == NULL || ooc->plan1 == NULL || ooc->plan2 == NULL ||
+        fft_twiddle_table_init(&ooc->twiddle, N) != 0) {
+        out_of_core_free(ooc);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Out of core FFT of a file of Complex values that does not have to
+ * fit in memory. The files are memory mapped and the transform is split
+ * into transforms of about sqrt(N) points on rows, with tiled transposes
+ * in between, five passes over the data that each read and write it once.
+ * The output file is used as scratch space and grows to 2N values while the
+ * transform runs. The input file is not changed.
+ *
+ * The result is scaled by 2^-exponent so it fits in 32 bits, exponent is
+ * 0 up to N = 2^15 and log2(N) - 15 above.
+ *
+ * @param input_path file with N Complex values, fixedpoint according to
+ * FFT_MATH_FRACTION_BITS, |value| < 1.0.
+ * @param output_path file for the N bin result, created or overwritten.
+ * @param N the length of the transform, a number 2^k, 4 <= N <= 2^FFT_OUT_OF_CORE_MAX_LOG2.
+ * @param memory the number of bytes for the transpose tile. The file is
+ * read and written in runs of sqrt(memory / 8) values rounded down to a
+ * power of two, at most sqrt(N). The budget has to hold a tile with runs
+ * of a page, 2 MiB with 4 KiB pages, less when sqrt(N) is smaller.
+ * @param exponent pointer where the scaling is stored, NULL is allowed.
+ *
+ * @return 0 on success, -1 if the arguments are invalid, the budget is too
+ * small, a file could not be opened or mapped, or the memory could not be
+ * allocated.
+ */
+int32_t fft_out_of_core(const char *input_path, const char *output_path, int64_t N,
+                        size_t memory, int32_t *exponent) {
+    OutOfCore ooc;
+    int32_t status = -1;
+    int in_fd, out_fd;
+    Complex *in = NULL, *out = NULL;
+    struct stat st;
+
+    if (N < 4 || (N & (N - 1)) != 0 || N > ((int64_t)1 << FFT_OUT_OF_CORE_MAX_LOG2)) {
+        return -1;
+    }
+    if (out_of_core_init(&ooc, N, memory) != 0) {
+        return -1;
+    }
+
+    in_fd = open(input_path, O_RDONLY);
+    out_fd = open(output_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (in_fd >= 0 && out_fd >= 0 && fstat(in_fd, &st) == 0 &&
+        st.st_size >= N * (int64_t)sizeof(Complex) &&
+        ftruncate(out_fd, 2 * N * (int64_t)sizeof(Complex)) == 0) {
+        in = map_file(in_fd, N, 0);
+        out = map_file(out_fd, 2 * N, 1);
+    }
+
+    if (in != NULL && out != NULL) {
+        Complex *a = out, *b = out + N;
+
+        transpose(&ooc, in, a, ooc.N1, ooc.N2);
+        transform_rows(&ooc, a, ooc.N2, ooc.N1, ooc.plan1, 1);
+        transpose(&ooc, a, b, ooc.N2, ooc.N1);
+        transform_rows(&ooc, b, ooc.N1, ooc.N2, ooc.plan2, 0);
+        transpose(&ooc, b, a, ooc.N1, ooc.N2);
+        if (msync(out, (size_t)N * sizeof(Complex), MS_SYNC) == 0) {
+            status = 0;
+        }
+        if (exponent != NULL) {
+            *exponent = ooc.shift;
+        }
+    }
+
+    if (in != NULL) {
+        munmap(in, (size_t)N * sizeof(Complex));
+    }
+    if (out != NULL) {
+        munmap(out, 2 * (size_t)N * sizeof(Complex));
+    }
+    if (status == 0 && ftruncate(out_fd, N * (int64_t)sizeof(Complex)) != 0) {
+        status = -1;
+    }
+    if (in_fd >= 0) {
+        close(in_fd);
+    }
+    if (out_fd >= 0) {
+        close(out_fd);
+    }
+    out_of_core_free(&ooc);
+    return status;
+}
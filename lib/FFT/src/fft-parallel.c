@@ -0,0 +1,347 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft-parallel.h"
+#include "cordic-math.h"
+
+/**
+ * @brief Fixedpoint complex multiplication a*b.
+ */
+static inline Complex complex_mul(Complex a, Complex b) {
+    Complex r;
+    r.real = (int)(((int64_t)a.real * b.real - (int64_t)a.imag * b.imag) >>
+                   FFT_MATH_FRACTION_BITS);
+    r.imag = (int)(((int64_t)a.real * b.imag + (int64_t)a.imag * b.real) >>
+                   FFT_MATH_FRACTION_BITS);
+    return r;
+}
+
+/**
+ * @brief Returns floor(log2(x)) for x > 0.
+ */
+static int32_t log2_64(int64_t x) {
+    int32_t r = 0;
+    while (x > 1) {
+        x >>= 1;
+        r++;
+    }
+    return r;
+}
+
+/**
+ * @brief exp(-2*pi*i*m/N) from cordic_sincos_q30(), rounded to
+ * FFT_MATH_FRACTION_BITS. The 1e-4 of cordic_sincos() would limit long
+ * transforms, fast convolutions in particular.
+ */
+static Complex twiddle_factor(int64_t m, int64_t N) {
+    Complex w;
+    int32_t s, c;
+    int32_t round = 1 << (CORDIC_SINCOS_Q30_BITS - FFT_MATH_FRACTION_BITS - 1);
+
+    cordic_sincos_q30((uint32_t)(((m % N) << 32) / N), &s, &c);
+    w.real = (c + round) >> (CORDIC_SINCOS_Q30_BITS - FFT_MATH_FRACTION_BITS);
+    w.imag = -((s + round) >> (CORDIC_SINCOS_Q30_BITS - FFT_MATH_FRACTION_BITS));
+    return w;
+}
+
+/**
+ * @brief Sets up a two level twiddle factor table for W_N^m, 0 <= m < N.
+ *
+ * @param table the table to set up.
+ * @param N the transform length, a number 2^k.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated.
+ */
+int32_t fft_twiddle_table_init(FftTwiddleTable *table, int64_t N) {
+    int32_t bits = log2_64(N);
+    int64_t lo_size, hi_size;
+
+    table->N = N;
+    table->lo_bits = (bits + 1) / 2;
+    lo_size = (int64_t)1 << table->lo_bits;
+    hi_size = N >> table->lo_bits;
+    table->lo = malloc(sizeof(Complex) * lo_size);
+    table->hi = malloc(sizeof(Complex) * (hi_size > 0 ? hi_size : 1));
+    if (table->lo == NULL || table->hi == NULL) {
+        fft_twiddle_table_free(table);
+        return -1;
+    }
+    for (int64_t j = 0; j < lo_size; j++) {
+        table->lo[j] = twiddle_factor(j, N);
+    }
+    for (int64_t j = 0; j < hi_size; j++) {
+        table->hi[j] = twiddle_factor(j << table->lo_bits, N);
+    }
+    return 0;
+}
+
+/**
+ * @brief Looks up W_N^m.
+ *
+ * @param table a table set up with fft_twiddle_table_init().
+ * @param m the exponent, any value, it is reduced modulo N.
+ *
+ * @return The fixedpoint twiddle factor.
+ */
+Complex fft_twiddle_table_get(const FftTwiddleTable *table, int64_t m) {
+    m &= table->N - 1;
+    return complex_mul(table->hi[m >> table->lo_bits],
+                       table->lo[m & (((int64_t)1 << table->lo_bits) - 1)]);
+}
+
+/**
+ * @brief Frees the memory of a twiddle table.
+ */
+void fft_twiddle_table_free(FftTwiddleTable *table) {
+    free(table->lo);
+    free(table->hi);
+    table->lo = NULL;
+    table->hi = NULL;
+}
+
+typedef struct {
+    const Complex *in;
+    Complex *out;
+    int32_t rows;
+    int32_t cols;
+} TransposeTask;
+
+/**
+ * @brief Transposes the tile rows [begin, end), one tile at a time.
+ */
+static void transpose_tiles(int32_t begin, int32_t end, void *ctx) {
+    const TransposeTask *t = ctx;
+
+    for (int32_t tr = begin; tr < end; tr++) {
+        int32_t r0 = tr * FFT_TRANSPOSE_TILE;
+        int32_t r1 = r0 + FFT_TRANSPOSE_TILE < t->rows ? r0 + FFT_TRANSPOSE_TILE : t->rows;
+        for (int32_t c0 = 0; c0 < t->cols; c0 += FFT_TRANSPOSE_TILE) {
+            int32_t c1 = c0 + FFT_TRANSPOSE_TILE < t->cols ? c0 + FFT_TRANSPOSE_TILE : t->cols;
+            for (int32_t r = r0; r < r1; r++) {
+                const Complex *src = &t->in[(int64_t)r * t->cols];
+                for (int32_t c = c0; c < c1; c++) {
+                    t->out[(int64_t)c * t->rows + r] = src[c];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Cache blocked out of place matrix transpose, the rows of tiles are
+ * spread over the threads of the pool.
+ *
+ * @param in the rows x cols matrix in row major order.
+ * @param out the cols x rows result, must not overlap in.
+ * @param rows the number of rows of in.
+ * @param cols the number of columns of in.
+ * @param pool the thread pool, NULL runs on the calling thread.
+ *
+ * @return 0
+ */
+int32_t fft_transpose(const Complex in[], Complex out[], int32_t rows, int32_t cols,
+                      ThreadPool *pool) {
+    TransposeTask task = {in, out, rows, cols};
+    int32_t tile_rows = (rows + FFT_TRANSPOSE_TILE - 1) / FFT_TRANSPOSE_TILE;
+
+    thread_pool_parallel_for(pool, tile_rows, 1, transpose_tiles, &task);
+    return 0;
+}
+
+typedef struct {
+    Complex *data;
+    int32_t length;
+    int32_t inverse;
+    const FftTwiddleTable *twiddle; /* NULL for plain row transforms */
+} RowTask;
+
+/**
+ * @brief FFTs of the rows [begin, end). With a twiddle table every element
+ * k of row n is multiplied by W_N^(n*k) while the row is still in the cache.
+ */
+static void fft_rows(int32_t begin, int32_t end, void *ctx) {
+    const RowTask *t = ctx;
+
+    for (int32_t n = begin; n < end; n++) {
+        Complex *row = &t->data[(int64_t)n * t->length];
+        if (t->inverse) {
+            inverse_fft(row, t->length);
+        } else {
+            fft(row, t->length);
+        }
+        if (t->twiddle != NULL) {
+            for (int32_t k = 1; k < t->length; k++) {
+                row[k] = complex_mul(row[k], fft_twiddle_table_get(t->twiddle, (int64_t)n * k));
+            }
+        }
+    }
+}
+
+typedef struct {
+    const Complex *src;
+    Complex *dst;
+    int32_t block;
+} CopyTask;
+
+static void copy_blocks(int32_t begin, int32_t end, void *ctx) {
+    const CopyTask *t = ctx;
+    memcpy(&t->dst[(int64_t)begin * t->block], &t->src[(int64_t)begin * t->block],
+           sizeof(Complex) * t->block * (end - begin));
+}
+
+/**
+ * @brief Creates a four-step FFT plan for very large transforms. The
+ * transform of length N = N1 * N2 is done as N2 transforms of length N1,
+ * a twiddle multiplication, N1 transforms of length N2 and cache blocked
+ * transposes in between, so every small transform runs on contiguous data
+ * that fits in the cache. All steps are spread over the thread pool.
+ *
+ * @param N the length of the transform, a number 2^k >= 4.
+ * @param pool the thread pool, NULL runs on the calling thread. The pool
+ * is not owned by the plan.
+ *
+ * @return Pointer to the plan, NULL if N is invalid or if the memory could
+ * not be allocated. Free the plan with fft_four_step_destroy().
+ */
+FftFourStep *fft_four_step_create(int32_t N, ThreadPool *pool) {
+    FftFourStep *plan;
+    int32_t bits;
+
+    if (N < 4 || (N & (N - 1)) != 0) {
+        return NULL;
+    }
+    plan = calloc(1, sizeof(FftFourStep));
+    if (plan == NULL) {
+        return NULL;
+    }
+    bits = log2_64(N);
+    plan->N = N;
+    plan->N1 = 1 << (bits / 2);
+    plan->N2 = N / plan->N1;
+    plan->pool = pool;
+    plan->work = malloc(sizeof(Complex) * N);
+    if (plan->work == NULL || fft_twiddle_table_init(&plan->twiddle, N) != 0) {
+        fft_four_step_destroy(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+/**
+ * @brief Runs a four-step FFT.
+ *
+ * @param plan a plan created by fft_four_step_create().
+ * @param x is a fixedpoint array of N complex values, the answer of the FFT
+ * will be in this array, in the same order as with fft().
+ *
+ * @return 0, -1 if plan is NULL.
+ */
+int32_t fft_four_step_execute(FftFourStep *plan, Complex x[]) {
+    RowTask rows;
+    CopyTask copy;
+
+    if (plan == NULL) {
+        return -1;
+    }
+
+    /* x is N1 x N2 with x[n1][n2] = x[N2*n1 + n2], its columns become rows */
+    fft_transpose(x, plan->work, plan->N1, plan->N2, plan->pool);
+
+    /* Column transforms and twiddle factors W_N^(n2*k1) */
+    rows.data = plan->work;
+    rows.length = plan->N1;
+    rows.inverse = 0;
+    rows.twiddle = &plan->twiddle;
+    thread_pool_parallel_for(plan->pool, plan->N2, 0, fft_rows, &rows);
+
+    /* Row transforms */
+    fft_transpose(plan->work, x, plan->N2, plan->N1, plan->pool);
+    rows.data = x;
+    rows.length = plan->N2;
+    rows.twiddle = NULL;
+    thread_pool_parallel_for(plan->pool, plan->N1, 0, fft_rows, &rows);
+
+    /* X[k1 + N1*k2] is element [k1][k2], transpose into natural order */
+    fft_transpose(x, plan->work, plan->N1, plan->N2, plan->pool);
+    copy.src = plan->work;
+    copy.dst = x;
+    copy.block = plan->N1;
+    thread_pool_parallel_for(plan->pool, plan->N2, 0, copy_blocks, &copy);
+
+    return 0;
+}
+
+/**
+ * @brief Frees a plan created by fft_four_step_create().
+ *
+ * @param plan the plan, NULL is allowed.
+ */
+void fft_four_step_destroy(FftFourStep *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    fft_twiddle_table_free(&plan->twiddle);
+    free(plan->work);
+    free(plan);
+}
+
+/**
+ * @brief Row and column transforms of a 2D FFT, the columns are turned
+ * into rows with a blocked transpose instead of being copied out one by
+ * one.
+ */
+static int32_t transform_2d(Complex x[], Complex work[], int32_t rows, int32_t cols,
+                            ThreadPool *pool, int32_t inverse) {
+    RowTask task;
+
+    if (rows < 1 || cols < 1 || (rows & (rows - 1)) != 0 || (cols & (cols - 1)) != 0) {
+        return -1;
+    }
+    task.inverse = inverse;
+    task.twiddle = NULL;
+
+    task.data = x;
+    task.length = cols;
+    thread_pool_parallel_for(pool, rows, 0, fft_rows, &task);
+
+    fft_transpose(x, work, rows, cols, pool);
+    task.data = work;
+    task.length = rows;
+    thread_pool_parallel_for(pool, cols, 0, fft_rows, &task);
+    fft_transpose(work, x, cols, rows, pool);
+    return 0;
+}
+
+/**
+ * @brief 2D FFT of a rows x cols image, all rows and then all columns are
+ * transformed, spread over the threads of the pool.
+ *
+ * @param x is a fixedpoint rows x cols array in row major order, the answer
+ * of the FFT will be in this array.
+ * @param work a buffer of rows * cols values for the transposes.
+ * @param rows the number of rows, a number 2^k.
+ * @param cols the number of columns, a number 2^k.
+ * @param pool the thread pool, NULL runs on the calling thread.
+ *
+ * @return 0 on success, -1 if rows or cols is not a power of two.
+ */
+int32_t fft2d(Complex x[], Complex work[], int32_t rows, int32_t cols, ThreadPool *pool) {
+    return transform_2d(x, work, rows, cols, pool, 0);
+}
+
+/**
+ * @brief Inverse 2D FFT, the 1/(rows*cols) scaling is included.
+ *
+ * @param x is a fixedpoint rows x cols array in row major order, the answer
+ * of the inverse FFT will be in this array.
+ * @param work a buffer of rows * cols values for the transposes.
+ * @param rows the number of rows, a number 2^k.
+ * @param cols the number of columns, a number 2^k.
+ * @param pool the thread pool, NULL runs on the calling thread.
+ *
+ * @return 0 on success, -1 if rows or cols is not a power of two.
+ */
+int32_t inverse_fft2d(Complex x[], Complex work[], int32_t rows, int32_t cols,
+                      ThreadPool *pool) {
+    return transform_2d(x, work, rows, cols, pool, 1);
+}
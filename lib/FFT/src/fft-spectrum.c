@@ -0,0 +1,124 @@
+#include <stddef.h>
+
+#include "fft-spectrum.h"
+#include "cordic-math.h"
+
+#define FLOAT_TO_INT(x) ((x) >= 0 ? (int)((x) + 0.5) : (int)((x)-0.5))
+
+#define SPECTRUM_ONE (1 << FFT_MATH_FRACTION_BITS)
+
+#if FFT_MATH_FRACTION_BITS >= CORDIC_MATH_FRACTION_BITS
+#define CORDIC_TO_FFT(x) ((x) << (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#define FFT_TO_CORDIC(x) ((x) >> (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#else
+#define CORDIC_TO_FFT(x) ((x) >> (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#define FFT_TO_CORDIC(x) ((x) << (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#endif
+
+/**
+ * @brief 20*log10(amplitude). The amplitude is split into 2^e * m with
+ * 1 <= m < 2 so cordic_ln() only sees values inside its range.
+ *
+ * @param amplitude fixedpoint according to FFT_MATH_FRACTION_BITS.
+ *
+ * @return dB, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ */
+static int32_t amplitude_db(int32_t amplitude) {
+    static const int64_t DB_PER_NEPER = FLOAT_TO_INT(8.68588963807 * SPECTRUM_ONE);
+    static const int64_t LN_2 = FLOAT_TO_INT(0.69314718056 * SPECTRUM_ONE);
+    int32_t e = 0, mantissa;
+    int64_t ln;
+
+    if (amplitude <= 0) {
+        return FFT_SPECTRUM_DB_FLOOR;
+    }
+    while ((amplitude >> e) > 1) {
+        e++;
+    }
+    /* mantissa = amplitude / 2^e with FFT_MATH_FRACTION_BITS fraction bits */
+    if (e >= FFT_MATH_FRACTION_BITS) {
+        mantissa = amplitude >> (e - FFT_MATH_FRACTION_BITS);
+    } else {
+        mantissa = amplitude << (FFT_MATH_FRACTION_BITS - e);
+    }
+    ln = (e - FFT_MATH_FRACTION_BITS) * LN_2 +
+         CORDIC_TO_FFT(cordic_ln(FFT_TO_CORDIC(mantissa)));
+    return (int32_t)((ln * DB_PER_NEPER) >> FFT_MATH_FRACTION_BITS);
+}
+
+/**
+ * @brief Turns FFT bins into a scaled spectrum in a single pass. Every bin
+ * is read once, one cordic vectoring gives both its magnitude and phase,
+ * and the scaling and the dB conversion are done on the spot, instead of
+ * separate passes for the magnitude, the phase and the scaling. Bin 0 and
+ * bin N/2 are scaled by 1/N, every other bin by 2/N.
+ *
+ * @param X the FFT result.
+ * @param N the length of the FFT.
+ * @param bins the number of bins to convert, starting at bin 0, bins <= N.
+ * For a real signal N/2 bins hold the whole spectrum.
+ * @param mode what to write into out and phase.
+ * @param out the amplitude of every bin, or its level in dB for
+ * FFT_SPECTRUM_POWER_DB, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ * @param phase the phase of every bin in degrees, -180 < phase <= 180,
+ * fixedpoint according to FFT_MATH_FRACTION_BITS. Only written for
+ * FFT_SPECTRUM_MAGNITUDE_PHASE, can be NULL for the other modes.
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t fft_spectrum_post(const Complex X[], int32_t N, int32_t bins, FftSpectrumMode mode,
+                          int32_t out[], int32_t phase[]) {
+    if (N < 1 || bins < 0 || bins > N ||
+        (mode == FFT_SPECTRUM_MAGNITUDE_PHASE && phase == NULL)) {
+        return -1;
+    }
+
+    for (int32_t k = 0; k < bins; k++) {
+        int32_t magnitude, angle;
+        int64_t amplitude;
+
+        cordic_vector(X[k].imag, X[k].real, &magnitude,
+                      mode == FFT_SPECTRUM_MAGNITUDE_PHASE ? &angle : NULL);
+        /* Bin 0 and the Nyquist bin have no mirror image */
+        amplitude = (k == 0 || 2 * k == N) ? magnitude : 2 * (int64_t)magnitude;
+        amplitude = (amplitude + N / 2) / N;
+
+        switch (mode) {
+        case FFT_SPECTRUM_POWER_DB:
+            out[k] = amplitude_db((int32_t)amplitude);
+            break;
+        case FFT_SPECTRUM_MAGNITUDE_PHASE:
+            phase[k] = CORDIC_TO_FFT(angle);
+            /* fall through */
+        case FFT_SPECTRUM_MAGNITUDE:
+        default:
+            out[k] = (int32_t)amplitude;
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs fft() and converts the first bins into a scaled spectrum
+ * right away with fft_spectrum_post(), while the result is still in the
+ * cache.
+ *
+ * @param x the samples, the FFT result is left in this array.
+ * @param N the length of the array, a number 2^k.
+ * @param bins the number of bins to convert, bins <= N.
+ * @param mode what to write into out and phase.
+ * @param out the amplitude or level of every bin.
+ * @param phase the phase of every bin, see fft_spectrum_post().
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t fft_spectrum(Complex x[], int32_t N, int32_t bins, FftSpectrumMode mode,
+                     int32_t out[], int32_t phase[]) {
+    if (N < 1 || bins < 0 || bins > N ||
+        (mode == FFT_SPECTRUM_MAGNITUDE_PHASE && phase == NULL)) {
+        return -1;
+    }
+    fft(x, N);
+    return fft_spectrum_post(x, N, bins, mode, out, phase);
+}
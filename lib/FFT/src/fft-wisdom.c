@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fft-wisdom.h"
+
+/*
+ * The wisdom is a small table of (N, algorithm) pairs. It is filled by
+ * fft_wisdom_measure() or fft_wisdom_load() and read by fft_plan_create().
+ * None of the functions are thread safe, load the wisdom once at startup
+ * before plans are created from several threads.
+ */
+typedef struct {
+    int32_t N;
+    FftAlgorithm algorithm;
+} WisdomEntry;
+
+static WisdomEntry wisdom[FFT_WISDOM_MAX_ENTRIES];
+static int32_t wisdom_count = 0;
+
+static const char *const algorithm_names[] = {
+    [FFT_ALGORITHM_RADIX_2] = "radix-2",
+    [FFT_ALGORITHM_MIXED_RADIX] = "mixed-radix",
+    [FFT_ALGORITHM_BLUESTEIN] = "bluestein",
+    [FFT_ALGORITHM_STOCKHAM] = "stockham",
+};
+
+#define NUM_ALGORITHMS ((int32_t)(sizeof(algorithm_names) / sizeof(algorithm_names[0])))
+
+/**
+ * @brief Adds or replaces the entry for N.
+ *
+ * @return 0 on success, -1 if the table is full.
+ */
+static int32_t wisdom_store(int32_t N, FftAlgorithm algorithm) {
+    for (int32_t i = 0; i < wisdom_count; i++) {
+        if (wisdom[i].N == N) {
+            wisdom[i].algorithm = algorithm;
+            return 0;
+        }
+    }
+    if (wisdom_count == FFT_WISDOM_MAX_ENTRIES) {
+        return -1;
+    }
+    wisdom[wisdom_count].N = N;
+    wisdom[wisdom_count].algorithm = algorithm;
+    wisdom_count++;
+    return 0;
+}
+
+/**
+ * @brief Runs the plan repeatedly for at least FFT_WISDOM_MEASURE_MS.
+ *
+ * @return The average time of one transform in clock() ticks.
+ */
+static double time_plan(const FftPlan *plan, const Complex input[], Complex x[]) {
+    clock_t start = clock(), elapsed;
+    clock_t duration = (clock_t)((int64_t)CLOCKS_PER_SEC * FFT_WISDOM_MEASURE_MS / 1000);
+    int32_t runs = 0;
+
+    do {
+        /* Restart from the same input, repeated transforms would overflow */
+        memcpy(x, input, sizeof(Complex) * plan->N);
+        fft_plan_execute(plan, x);
+        runs++;
+        elapsed = clock() - start;
+    } while (elapsed < duration || runs < 3);
+
+    return (double)elapsed / runs;
+}
+
+/**
+ * @brief Looks up the algorithm the wisdom holds for N.
+ *
+ * @param N the transform length.
+ * @param algorithm pointer where the algorithm is stored.
+ *
+ * @return 0 if the wisdom has an entry for N, -1 if not.
+ */
+int32_t fft_wisdom_lookup(int32_t N, FftAlgorithm *algorithm) {
+    for (int32_t i = 0; i < wisdom_count; i++) {
+        if (wisdom[i].N == N) {
+            *algorithm = wisdom[i].algorithm;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Times every algorithm that can do a transform of length N and
+ * stores the fastest in the wisdom. Bluestein is always the slowest, it is
+ * not timed and only picked when no other algorithm can do N.
+ *
+ * @param N the transform length, N >= 1.
+ * @param algorithm pointer where the fastest algorithm is stored, NULL is
+ * allowed.
+ *
+ * @return 0 on success, -1 if N is invalid, the memory could not be
+ * allocated or the wisdom is full.
+ */
+int32_t fft_wisdom_measure(int32_t N, FftAlgorithm *algorithm) {
+    Complex *input, *x;
+    FftAlgorithm best = FFT_ALGORITHM_BLUESTEIN;
+    double best_time = 0;
+    int32_t found = 0;
+
+    if (N < 1) {
+        return -1;
+    }
+    input = malloc(sizeof(Complex) * N);
+    x = malloc(sizeof(Complex) * N);
+    if (input == NULL || x == NULL) {
+        free(input);
+        free(x);
+        return -1;
+    }
+    for (int32_t n = 0; n < N; n++) {
+        input[n].real = (int32_t)(((int64_t)n * 7919) % 4096 - 2048);
+        input[n].imag = (int32_t)(((int64_t)n * 104729) % 4096 - 2048);
+    }
+
+    for (int32_t a = 0; a < NUM_ALGORITHMS; a++) {
+        FftPlan *plan;
+        double t;
+
+        if (a == FFT_ALGORITHM_BLUESTEIN) {
+            continue;
+        }
+        plan = fft_plan_create_algorithm(N, (FftAlgorithm)a);
+        if (plan == NULL) {
+            continue;
+        }
+        t = time_plan(plan, input, x);
+        if (!found || t < best_time) {
+            best = (FftAlgorithm)a;
+            best_time = t;
+            found = 1;
+        }
+        fft_plan_destroy(plan);
+    }
+
+    free(input);
+    free(x);
+    if (algorithm != NULL) {
+        *algorithm = best;
+    }
+    return wisdom_store(N, best);
+}
+
+/**
+ * @brief Creates a plan with the algorithm the wisdom holds for N, N is
+ * measured with fft_wisdom_measure() first if the wisdom has no entry.
+ *
+ * @param N is the length of the transform, N >= 1.
+ *
+ * @return Pointer to the plan, NULL if N is invalid or if the memory could
+ * not be allocated. Free the plan with fft_plan_destroy().
+ */
+FftPlan *fft_plan_create_measured(int32_t N) {
+    FftAlgorithm algorithm;
+
+    if (fft_wisdom_lookup(N, &algorithm) != 0 && fft_wisdom_measure(N, &algorithm) != 0) {
+        return fft_plan_create(N);
+    }
+    return fft_plan_create_algorithm(N, algorithm);
+}
+
+/**
+ * @brief Adds the entries of a wisdom file to the wisdom, entries for a
+ * length that is already known replace the old entry. Unknown algorithm
+ * names are skipped, so a file from a newer version still loads.
+ *
+ * @param path the file written by fft_wisdom_save().
+ *
+ * @return The number of entries loaded, -1 if the file could not be read.
+ */
+int32_t fft_wisdom_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[64], name[32];
+    int32_t loaded = 0;
+    long N;
+
+    if (file == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%ld %31s", &N, name) != 2 || N < 1) {
+            continue;
+        }
+        for (int32_t a = 0; a < NUM_ALGORITHMS; a++) {
+            if (strcmp(name, algorithm_names[a]) == 0) {
+                if (wisdom_store((int32_t)N, (FftAlgorithm)a) == 0) {
+                    loaded++;
+                }
+                break;
+            }
+        }
+    }
+    fclose(file);
+    return loaded;
+}
+
+/**
+ * @brief Writes the wisdom to a text file, one "N algorithm" line per
+ * transform length.
+ *
+ * @param path the file, it is overwritten.
+ *
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int32_t fft_wisdom_save(const char *path) {
+    FILE *file = fopen(path, "w");
+    int32_t status = 0;
+
+    if (file == NULL) {
+        return -1;
+    }
+    fprintf(file, "# fft wisdom, N algorithm\n");
+    for (int32_t i = 0; i < wisdom_count; i++) {
+        fprintf(file, "%ld %s\n", (long)wisdom[i].N, algorithm_names[wisdom[i].algorithm]);
+    }
+    if (ferror(file)) {
+        status = -1;
+    }
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+/**
+ * @brief Clears the wisdom, plans are created with the default choice
+ * again.
+ */
+void fft_wisdom_forget(void) {
+    wisdom_count = 0;
+}
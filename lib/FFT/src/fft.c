@@ -1,7 +1,24 @@
 #include "fft.h"
 
+static int32_t ones_32(int32_t n);
+static int32_t floor_log2_32(int32_t x);
+static void radix2_transform(Complex x[], int32_t N, int32_t inverse);
+
 #define FLOAT_TO_INT(x) ((x) >= 0 ? (int)((x) + 0.5) : (int)((x)-0.5))
 
+#if FFT_MATH_FRACTION_BITS >= 15
+#define FFT_TO_Q15(x) ((x) >> (FFT_MATH_FRACTION_BITS - 15))
+#else
+#define FFT_TO_Q15(x) ((x) << (15 - FFT_MATH_FRACTION_BITS))
+#endif
+
+/* Fraction bits of the twiddle factor recursion of radix2_transform() */
+#define TWIDDLE_BITS 30
+#define TWIDDLE_ROUND ((int64_t)1 << (TWIDDLE_BITS - FFT_MATH_FRACTION_BITS - 1))
+
+/* Branchless |x|, off by one for negative numbers which is fine for a peak bound */
+#define Q15_MAGNITUDE(x) ((int32_t)(x) ^ ((int32_t)(x) >> 31))
+
 static const int sin_tb[] = {
     FLOAT_TO_INT(0.000000 * (1 << FFT_MATH_FRACTION_BITS)), //PI
     FLOAT_TO_INT(1.000000 * (1 << FFT_MATH_FRACTION_BITS)), //PI/2
@@ -48,6 +65,55 @@ static const int cos_tb[] = {
     FLOAT_TO_INT( 1.000000 * (1 << FFT_MATH_FRACTION_BITS)),  //...
     FLOAT_TO_INT( 1.000000 * (1 << FFT_MATH_FRACTION_BITS))}; //PI/(2^K)
 
+/* The same angles with TWIDDLE_BITS fraction bits, the recursion of the
+ * twiddle factors in radix2_transform() multiplies their rounding error by
+ * the number of steps */
+static const int sin_q30_tb[] = {
+    FLOAT_TO_INT( 0.000000000000 * (1 << TWIDDLE_BITS)), //PI
+    FLOAT_TO_INT( 1.000000000000 * (1 << TWIDDLE_BITS)), //PI/2
+    FLOAT_TO_INT( 0.707106781187 * (1 << TWIDDLE_BITS)), //PI/4
+    FLOAT_TO_INT( 0.382683432365 * (1 << TWIDDLE_BITS)), //PI/8
+    FLOAT_TO_INT( 0.195090322016 * (1 << TWIDDLE_BITS)), //PI/16
+    FLOAT_TO_INT( 0.098017140330 * (1 << TWIDDLE_BITS)), //...
+    FLOAT_TO_INT( 0.049067674327 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.024541228523 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.012271538286 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.006135884649 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.003067956763 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.001533980186 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000766990319 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000383495188 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000191747597 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000095873799 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000047936900 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000023968450 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000011984225 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000005992112 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.000002996056 * (1 << TWIDDLE_BITS))}; //PI/(2^K)
+
+static const int cos_q30_tb[] = {
+    FLOAT_TO_INT(-1.000000000000 * (1 << TWIDDLE_BITS)), //PI
+    FLOAT_TO_INT( 0.000000000000 * (1 << TWIDDLE_BITS)), //PI/2
+    FLOAT_TO_INT( 0.707106781187 * (1 << TWIDDLE_BITS)), //PI/4
+    FLOAT_TO_INT( 0.923879532511 * (1 << TWIDDLE_BITS)), //PI/8
+    FLOAT_TO_INT( 0.980785280403 * (1 << TWIDDLE_BITS)), //PI/16
+    FLOAT_TO_INT( 0.995184726672 * (1 << TWIDDLE_BITS)), //...
+    FLOAT_TO_INT( 0.998795456205 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999698818696 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999924701839 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999981175283 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999995293810 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999998823452 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999705863 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999926466 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999981616 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999995404 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999998851 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999999713 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999999928 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999999982 * (1 << TWIDDLE_BITS)),
+    FLOAT_TO_INT( 0.999999999996 * (1 << TWIDDLE_BITS))}; //PI/(2^K)
+
 /**
  * @brief Simple Fast Fourier Transform also known as FFT.
  *
@@ -61,74 +127,80 @@ static const int cos_tb[] = {
  * @return The function returns 0, the answer is in the array.
  */
 int32_t fft(Complex x[], int32_t N) {
-    int i, j, l, k, ip;
-    static int32_t M = 0;
-    static int le, le2;
-    static int sR, sI;
-    static int uR, uI, tR, tI;
+    radix2_transform(x, N, 0);
+    return 0;
+}
 
-    M = floor_log2_32(N);
-    /*
-     * bit reversal sorting
-     */
-    l = N >> 1;
-    j = l;
-    ip = N - 2;
-    for (i = 1; i <= ip; i++) {
-        if (i < j) {
-            tR = x[j].real;
-            tI = x[j].imag;
-            x[j].real = x[i].real;
-            x[j].imag = x[i].imag;
-            x[i].real = tR;
-            x[i].imag = tI;
-        }
-        k = l;
-        while (k <= j) {
-            j = j - k;
-            k = k >> 1;
-        }
-        j = j + k;
-    }
+/**
+ * @brief Out of place Fast Fourier Transform using the Stockham autosort
+ * algorithm. Every stage reads one buffer and writes the other in
+ * sequential order, so no bit reversal pass is needed. Prefer this over
+ * fft() for large N when the extra buffer is affordable.
+ *
+ * @param x is a fixedpoint array of the complex datatype defined in fft.h,
+ * the answer of the FFT will be in this array. The data in this
+ * array will be deleted, make sure to save the data if you need it.
+ *
+ * @param work is a scratch array of length N, its content is overwritten.
+ *
+ * @param N is the length of the array. NOTE this variable need to
+ * be a number 2^k.
+ *
+ * @return The function returns 0, the answer is in the array x.
+ */
+int32_t fft_stockham(Complex x[], Complex work[], int32_t N) {
+    Complex *src = x, *dst = work, *tmp;
+    int32_t n, m, s, q, k, t;
+    int sR, sI, uR, uI, tR, tI;
 
-    /*
-     * For Loops
-     */
-    for (l = 1; l <= M; l++) {
-        le = (int)(1 << l);
-        le2 = (int)(le >> 1);
+    for (n = N, s = 1; n > 1; n >>= 1, s <<= 1) {
+        m = n >> 1;
         uR = 1 << FFT_MATH_FRACTION_BITS;
-        uI = 0 << FFT_MATH_FRACTION_BITS;
+        uI = 0;
 
-        k = floor_log2_32(le2);
-        sR = cos_tb[k];
-        sI = -sin_tb[k];
-        for (j = 1; j <= le2; j++) {          /* loop for each sub DFT */
-            for (i = j - 1; i < N; i += le) { /* loop for each butterfly */
-                ip = i + le2;
-                tR = (((long)uR * x[ip].real) >> FFT_MATH_FRACTION_BITS) -
-                     (((long)uI * x[ip].imag) >> FFT_MATH_FRACTION_BITS);
-                tI = (((long)uI * x[ip].real) >> FFT_MATH_FRACTION_BITS) +
-                     (((long)uR * x[ip].imag) >> FFT_MATH_FRACTION_BITS);
-                x[ip].real = x[i].real - tR;
-                x[ip].imag = x[i].imag - tI;
-                x[i].real += tR;
-                x[i].imag += tI;
-            } /* Next i */
+        t = floor_log2_32(m);
+        sR = cos_tb[t];
+        sI = -sin_tb[t];
+        for (q = 0; q < m; q++) {         /* loop for each twiddle factor */
+            const Complex *a = &src[s * q];
+            const Complex *b = &src[s * (q + m)];
+            Complex *y0 = &dst[s * (2 * q)];
+            Complex *y1 = &dst[s * (2 * q + 1)];
+            for (k = 0; k < s; k++) {     /* loop for each butterfly */
+                tR = a[k].real - b[k].real;
+                tI = a[k].imag - b[k].imag;
+                y0[k].real = a[k].real + b[k].real;
+                y0[k].imag = a[k].imag + b[k].imag;
+                y1[k].real = (((long)uR * tR) >> FFT_MATH_FRACTION_BITS) -
+                             (((long)uI * tI) >> FFT_MATH_FRACTION_BITS);
+                y1[k].imag = (((long)uI * tR) >> FFT_MATH_FRACTION_BITS) +
+                             (((long)uR * tI) >> FFT_MATH_FRACTION_BITS);
+            } /* Next k */
             /* Calculation of twiddle factor */
             tR = uR;
             uR = (((long)tR * sR) >> FFT_MATH_FRACTION_BITS) -
                  (((long)uI * sI) >> FFT_MATH_FRACTION_BITS);
             uI = (((long)tR * sI) >> FFT_MATH_FRACTION_BITS) +
                  (((long)uI * sR) >> FFT_MATH_FRACTION_BITS);
-        } /* Next j */
-    }     /* Next l */
+        } /* Next q */
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    } /* Next n */
+
+    if (src != x) {
+        for (k = 0; k < N; k++) {
+            x[k] = src[k];
+        }
+    }
 
     return 0;
 }
 
 /**
- * @brief Simple inverse Fast Fourier Transform also known as IFFT. 
+ * @brief Simple inverse Fast Fourier Transform also known as IFFT. The
+ * transform runs with its own twiddle sign and the division by N is a
+ * rounding shift in the last stage.
  * 
  * @param x is a fixedpoint array of the complex datatype defined in fft.h,
  * the answer of the IFFT will be in this array. The data in this
@@ -140,22 +212,268 @@ int32_t fft(Complex x[], int32_t N) {
  * @return The function returns 0, the answer is in the array. 
  */
 int32_t inverse_fft(Complex x[], int32_t N) {
-    int k = 0;
+    radix2_transform(x, N, 1);
+    return 0;
+}
 
-    for (k = 0; k <= N - 1; k++) {
-        x[k].imag = -x[k].imag;
+/**
+ * @brief Reverses the lowest bits of v.
+ *
+ * @param v the number.
+ * @param bits the number of bits to reverse.
+ * @return v with its lowest bits in reversed order.
+ */
+static int32_t reverse_bits(int32_t v, int32_t bits) {
+    int32_t r = 0;
+    for (int32_t b = 0; b < bits; b++) {
+        r = (r << 1) | ((v >> b) & 1);
     }
+    return r;
+}
 
-    fft(x, N); /* using FFT */
+/**
+ * @brief Swaps two elements of the complex array.
+ */
+static inline void swap_complex(Complex x[], int32_t i, int32_t j) {
+    Complex t = x[i];
+    x[i] = x[j];
+    x[j] = t;
+}
 
-    for (k = 0; k <= N - 1; k++) {
-        x[k].real = x[k].real / N;
-        x[k].imag = -x[k].imag / N;
+/**
+ * @brief Swaps two elements of the Q15 complex array.
+ */
+static inline void swap_complex_q15(ComplexQ15 x[], int32_t i, int32_t j) {
+    ComplexQ15 t = x[i];
+    x[i] = x[j];
+    x[j] = t;
+}
+
+/*
+ * Bit reversal sorting shared by the Complex and ComplexQ15 transforms,
+ * SWAP is the function that swaps two elements of x. Small arrays use the
+ * classic loop, arrays with N >= FFT_BITREV_BLOCKED_MIN are sorted in blocks
+ * of 2^FFT_BITREV_BLOCK_BITS x 2^FFT_BITREV_BLOCK_BITS elements. The index is
+ * split into a high, middle and low part, for each middle part all swaps
+ * between two small tiles are done before moving on, so every cache line
+ * that is loaded is fully used instead of being evicted after a single
+ * element.
+ */
+#define BIT_REVERSE_SORT(x, N, SWAP)                                              \
+    do {                                                                          \
+        int32_t i, j, k, l, ip;                                                   \
+        if ((N) < FFT_BITREV_BLOCKED_MIN) {                                       \
+            l = (N) >> 1;                                                         \
+            j = l;                                                                \
+            ip = (N) - 2;                                                         \
+            for (i = 1; i <= ip; i++) {                                           \
+                if (i < j) {                                                      \
+                    SWAP(x, i, j);                                                \
+                }                                                                 \
+                k = l;                                                            \
+                while (k <= j) {                                                  \
+                    j = j - k;                                                    \
+                    k = k >> 1;                                                   \
+                }                                                                 \
+                j = j + k;                                                        \
+            }                                                                     \
+            break;                                                                \
+        }                                                                         \
+        int32_t block = 1 << FFT_BITREV_BLOCK_BITS;                               \
+        int32_t bits = floor_log2_32(N);                                          \
+        int32_t mid_bits = bits - 2 * FFT_BITREV_BLOCK_BITS;                      \
+        int32_t high_shift = bits - FFT_BITREV_BLOCK_BITS;                        \
+        int32_t rev_block[1 << FFT_BITREV_BLOCK_BITS];                            \
+        for (i = 0; i < block; i++) {                                             \
+            rev_block[i] = reverse_bits(i, FFT_BITREV_BLOCK_BITS);                \
+        }                                                                         \
+        for (int32_t mid = 0; mid < (1 << mid_bits); mid++) {                     \
+            int32_t rev_mid = reverse_bits(mid, mid_bits);                        \
+            if (mid > rev_mid) {                                                  \
+                continue; /* the pair was handled when mid was rev_mid */         \
+            }                                                                     \
+            for (int32_t hi = 0; hi < block; hi++) {                              \
+                int32_t base_i = (hi << high_shift) | (mid << FFT_BITREV_BLOCK_BITS); \
+                int32_t base_j = (rev_mid << FFT_BITREV_BLOCK_BITS) | rev_block[hi];  \
+                for (int32_t lo = 0; lo < block; lo++) {                          \
+                    i = base_i | lo;                                              \
+                    j = base_j | (rev_block[lo] << high_shift);                   \
+                    if (mid < rev_mid || i < j) {                                 \
+                        SWAP(x, i, j);                                            \
+                    }                                                             \
+                }                                                                 \
+            }                                                                     \
+        }                                                                         \
+    } while (0)
+
+/**
+ * @brief Bit reversal sorting of the array, arrays with
+ * N >= FFT_BITREV_BLOCKED_MIN are sorted tile by tile to stay in the cache.
+ *
+ * @param x the array.
+ * @param N the length of the array, a number 2^k.
+ *
+ * @return The function returns 0, the sorted data is in the array.
+ */
+int32_t fft_bit_reverse(Complex x[], int32_t N) {
+    BIT_REVERSE_SORT(x, N, swap_complex);
+    return 0;
+}
+
+/**
+ * @brief Fast Fourier Transform on 16 bit Q15 data with block floating
+ * point scaling. Before every stage the largest component in the array is
+ * compared against the growth a radix-2 butterfly can cause, and the stage
+ * output is shifted right by 0, 1 or 2 bits so it never overflows. The
+ * shifts are accumulated in exponent, the true spectrum is x * 2^exponent.
+ *
+ * @param x is a Q15 fixedpoint array of the complex datatype defined in fft.h,
+ * the answer of the FFT will be in this array. The data in this
+ * array will be deleted, make sure to save the data if you need it.
+ *
+ * @param N is the length of the array. NOTE this variable need to
+ * be a number 2^k.
+ *
+ * @param exponent pointer where the accumulated block exponent is stored.
+ *
+ * @return The function returns 0, the answer is in the array.
+ */
+int32_t fft_q15(ComplexQ15 x[], int32_t N, int32_t *exponent) {
+    int32_t i, j, l, k, ip, M, le, le2, shift, round, peak = 0;
+    int32_t sR, sI, uR, uI, tR, tI, wR, wI, aR, aI, bR, bI;
+
+    *exponent = 0;
+    M = floor_log2_32(N);
+    BIT_REVERSE_SORT(x, N, swap_complex_q15);
+
+    for (i = 0; i < N; i++) {
+        peak |= Q15_MAGNITUDE(x[i].real) | Q15_MAGNITUDE(x[i].imag);
     }
 
+    for (l = 1; l <= M; l++) {
+        le = 1 << l;
+        le2 = le >> 1;
+        shift = (peak >= FFT_Q15_GROWTH_LIMIT) + (peak >= 2 * FFT_Q15_GROWTH_LIMIT);
+        round = (1 << shift) >> 1;
+        *exponent += shift;
+        peak = 0;
+
+        uR = 1 << FFT_MATH_FRACTION_BITS;
+        uI = 0;
+        k = floor_log2_32(le2);
+        sR = cos_tb[k];
+        sI = -sin_tb[k];
+        for (j = 1; j <= le2; j++) {          /* loop for each sub DFT */
+            wR = FFT_TO_Q15(uR);
+            wI = FFT_TO_Q15(uI);
+            for (i = j - 1; i < N; i += le) { /* loop for each butterfly */
+                ip = i + le2;
+                tR = ((wR * x[ip].real) >> 15) - ((wI * x[ip].imag) >> 15);
+                tI = ((wI * x[ip].real) >> 15) + ((wR * x[ip].imag) >> 15);
+                aR = x[i].real;
+                aI = x[i].imag;
+                bR = (aR - tR + round) >> shift;
+                bI = (aI - tI + round) >> shift;
+                aR = (aR + tR + round) >> shift;
+                aI = (aI + tI + round) >> shift;
+                x[ip].real = (int16_t)bR;
+                x[ip].imag = (int16_t)bI;
+                x[i].real = (int16_t)aR;
+                x[i].imag = (int16_t)aI;
+                peak |= Q15_MAGNITUDE(aR) | Q15_MAGNITUDE(aI) |
+                        Q15_MAGNITUDE(bR) | Q15_MAGNITUDE(bI);
+            } /* Next i */
+            /* Calculation of twiddle factor */
+            tR = uR;
+            uR = (((long)tR * sR) >> FFT_MATH_FRACTION_BITS) -
+                 (((long)uI * sI) >> FFT_MATH_FRACTION_BITS);
+            uI = (((long)tR * sI) >> FFT_MATH_FRACTION_BITS) +
+                 (((long)uI * sR) >> FFT_MATH_FRACTION_BITS);
+        } /* Next j */
+    }     /* Next l */
+
     return 0;
 }
 
+/**
+ * @brief The in place radix-2 transform behind fft() and inverse_fft().
+ * The inverse transform uses the conjugated twiddle factors, and its 1/N
+ * scaling is done as a rounding shift in the last stage, so no extra passes
+ * over the data are needed. The twiddle factor recursion runs with
+ * TWIDDLE_BITS fraction bits and is only rounded to FFT_MATH_FRACTION_BITS
+ * for the butterflies, so the twiddle factors stay exact to the LSB for long
+ * transforms.
+ *
+ * @param x the array.
+ * @param N the length of the array, a number 2^k.
+ * @param inverse 0 for the forward transform, 1 for the inverse.
+ */
+static void radix2_transform(Complex x[], int32_t N, int32_t inverse) {
+    int i, j, l, k, ip;
+    int32_t M;
+    int le, le2;
+    int64_t sR, sI, wR, wI, vR;
+    int uR, uI, tR, tI;
+    int shift = 0, round = 0;
+
+    M = floor_log2_32(N);
+    /*
+     * bit reversal sorting
+     */
+    fft_bit_reverse(x, N);
+
+    /*
+     * For Loops
+     */
+    for (l = 1; l <= M; l++) {
+        le = (int)(1 << l);
+        le2 = (int)(le >> 1);
+        wR = (int64_t)1 << TWIDDLE_BITS;
+        wI = 0;
+
+        k = floor_log2_32(le2);
+        sR = cos_q30_tb[k];
+        sI = inverse ? sin_q30_tb[k] : -sin_q30_tb[k];
+        if (inverse && l == M) {
+            shift = M;
+            round = 1 << (M - 1);
+        }
+        for (j = 1; j <= le2; j++) {          /* loop for each sub DFT */
+            uR = (int)((wR + TWIDDLE_ROUND) >> (TWIDDLE_BITS - FFT_MATH_FRACTION_BITS));
+            uI = (int)((wI + TWIDDLE_ROUND) >> (TWIDDLE_BITS - FFT_MATH_FRACTION_BITS));
+            if (shift == 0) {
+                for (i = j - 1; i < N; i += le) { /* loop for each butterfly */
+                    ip = i + le2;
+                    tR = (((long)uR * x[ip].real) >> FFT_MATH_FRACTION_BITS) -
+                         (((long)uI * x[ip].imag) >> FFT_MATH_FRACTION_BITS);
+                    tI = (((long)uI * x[ip].real) >> FFT_MATH_FRACTION_BITS) +
+                         (((long)uR * x[ip].imag) >> FFT_MATH_FRACTION_BITS);
+                    x[ip].real = x[i].real - tR;
+                    x[ip].imag = x[i].imag - tI;
+                    x[i].real += tR;
+                    x[i].imag += tI;
+                } /* Next i */
+            } else {
+                for (i = j - 1; i < N; i += le) { /* last inverse stage, scaled by 1/N */
+                    ip = i + le2;
+                    tR = (((long)uR * x[ip].real) >> FFT_MATH_FRACTION_BITS) -
+                         (((long)uI * x[ip].imag) >> FFT_MATH_FRACTION_BITS);
+                    tI = (((long)uI * x[ip].real) >> FFT_MATH_FRACTION_BITS) +
+                         (((long)uR * x[ip].imag) >> FFT_MATH_FRACTION_BITS);
+                    x[ip].real = (int)(((long)x[i].real - tR + round) >> shift);
+                    x[ip].imag = (int)(((long)x[i].imag - tI + round) >> shift);
+                    x[i].real = (int)(((long)x[i].real + tR + round) >> shift);
+                    x[i].imag = (int)(((long)x[i].imag + tI + round) >> shift);
+                } /* Next i */
+            }
+            /* Calculation of twiddle factor */
+            vR = wR;
+            wR = (vR * sR - wI * sI + (1 << (TWIDDLE_BITS - 1))) >> TWIDDLE_BITS;
+            wI = (vR * sI + wI * sR + (1 << (TWIDDLE_BITS - 1))) >> TWIDDLE_BITS;
+        } /* Next j */
+    }     /* Next l */
+}
+
 /**
  * @brief Returns the number of ones, bitwise in an function.
  *
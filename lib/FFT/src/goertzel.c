@@ -0,0 +1,104 @@
+#include <string.h>
+
+#include "goertzel.h"
+#include "cordic-math.h"
+
+#define Q_ONE ((int64_t)1 << GOERTZEL_COEFFICIENT_BITS)
+
+/**
+ * @brief Multiplies the filter state by a coefficient with
+ * GOERTZEL_COEFFICIENT_BITS fraction bits. The state grows to about N^2
+ * times the input for the low bins, so the coefficient is split in two
+ * halves of 15 bits to keep the products within 64 bits.
+ */
+static inline int64_t coefficient_mul(int64_t s, int32_t c) {
+    return (s * (c >> 15) + ((s * (c & 0x7fff)) >> 15)) >> 15;
+}
+
+/**
+ * @brief Sets up a bank of Goertzel filters that each calculate one bin of
+ * an N point DFT. The cost is O(num_bins) per sample instead of the
+ * O(N log N) per block of a full FFT. The coefficients are calculated once
+ * with GOERTZEL_COEFFICIENT_BITS fraction bits, the recursion amplifies
+ * their rounding by about N.
+ *
+ * @param bank the bank to set up.
+ * @param N the block length, the bins are the bins of an N point DFT.
+ * @param bins the bin indexes to track, 0 <= bins[i] < N.
+ * @param num_bins the number of bins, at most GOERTZEL_MAX_BINS.
+ * @param callback called with the result at the end of every block.
+ * @param user passed on to the callback.
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t goertzel_init(GoertzelBank *bank, int32_t N, const int32_t bins[],
+                      int32_t num_bins, GoertzelCallback callback, void *user) {
+    memset(bank, 0, sizeof(GoertzelBank));
+    if (N < 1 || num_bins < 1 || num_bins > GOERTZEL_MAX_BINS || callback == NULL) {
+        return -1;
+    }
+    bank->N = N;
+    bank->num_bins = num_bins;
+    bank->callback = callback;
+    bank->user = user;
+
+    for (int32_t b = 0; b < num_bins; b++) {
+        if (bins[b] < 0 || bins[b] >= N) {
+            return -1;
+        }
+        /* w = 2 pi bins[b] / N of a turn of 2^32 */
+        cordic_sincos_q30((uint32_t)(((int64_t)bins[b] << 32) / N), &bank->sin_w[b],
+                          &bank->cos_w[b]);
+        /* cos(0) = 1 does not fit, the largest value is 1 - 2^-30 */
+        bank->sin_w[b] = bank->sin_w[b] >= Q_ONE ? Q_ONE - 1 : bank->sin_w[b];
+        bank->cos_w[b] = bank->cos_w[b] >= Q_ONE ? Q_ONE - 1 : bank->cos_w[b];
+    }
+    return 0;
+}
+
+/**
+ * @brief Feeds samples into the bank, the callback is called every time a
+ * block of N samples is completed.
+ *
+ * @param bank the bank.
+ * @param samples fixedpoint samples according to FFT_MATH_FRACTION_BITS.
+ * @param count the number of samples, any size.
+ *
+ * @return The number of completed blocks.
+ */
+int32_t goertzel_push(GoertzelBank *bank, const int32_t samples[], int32_t count) {
+    Complex out[GOERTZEL_MAX_BINS];
+    int32_t blocks = 0;
+
+    for (int32_t i = 0; i < count; i++) {
+        int64_t x = samples[i];
+
+        /* s[n] = x[n] + 2*cos(w)*s[n-1] - s[n-2] */
+        for (int32_t b = 0; b < bank->num_bins; b++) {
+            int64_t s0 = x + 2 * coefficient_mul(bank->s1[b], bank->cos_w[b]) - bank->s2[b];
+            bank->s2[b] = bank->s1[b];
+            bank->s1[b] = s0;
+        }
+
+        if (++bank->count == bank->N) {
+            /* X[k] = cos(w)*s[N-1] - s[N-2] + i*sin(w)*s[N-1] */
+            for (int32_t b = 0; b < bank->num_bins; b++) {
+                out[b].real = (int)(coefficient_mul(bank->s1[b], bank->cos_w[b]) - bank->s2[b]);
+                out[b].imag = (int)coefficient_mul(bank->s1[b], bank->sin_w[b]);
+            }
+            goertzel_reset(bank);
+            bank->callback(out, bank->num_bins, bank->user);
+            blocks++;
+        }
+    }
+    return blocks;
+}
+
+/**
+ * @brief Clears the filter state and starts a new block.
+ */
+void goertzel_reset(GoertzelBank *bank) {
+    bank->count = 0;
+    memset(bank->s1, 0, sizeof(bank->s1));
+    memset(bank->s2, 0, sizeof(bank->s2));
+}
@@ -0,0 +1,113 @@
+#include <string.h>
+
+#include "sliding-dft.h"
+#include "cordic-math.h"
+
+#if FFT_MATH_FRACTION_BITS >= CORDIC_MATH_FRACTION_BITS
+#define CORDIC_TO_FFT(x) ((x) << (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#else
+#define CORDIC_TO_FFT(x) ((x) >> (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#endif
+
+/**
+ * @brief Sets up a modulated sliding DFT that keeps a set of bins of the DFT
+ * over the last N samples up to date in O(num_bins) per sample.
+ *
+ * Instead of rotating the bins every sample, which lets rounding errors
+ * build up, each new sample is multiplied by W_N^(k*n) and added to an
+ * integer accumulator, and the sample leaving the window is removed with
+ * the same twiddle factor. The products are kept at full precision so the
+ * removal is exact and the bins never drift. The rotation back to the
+ * window start is done in sliding_dft_bins().
+ *
+ * @param sdft the SlidingDft to set up.
+ * @param N the window length.
+ * @param bins the bin indexes to track, 0 <= bins[i] < N.
+ * @param num_bins the number of bins, at most SLIDING_DFT_MAX_BINS.
+ * @param history array of N samples owned by the caller.
+ * @param twiddle array of N twiddle factors owned by the caller, it is
+ * filled here with the cordic algorithm and can be shared between
+ * SlidingDfts with the same N.
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t sliding_dft_init(SlidingDft *sdft, int32_t N, const int32_t bins[],
+                         int32_t num_bins, int32_t history[], Complex twiddle[]) {
+    memset(sdft, 0, sizeof(SlidingDft));
+    if (N < 1 || num_bins < 1 || num_bins > SLIDING_DFT_MAX_BINS ||
+        history == NULL || twiddle == NULL) {
+        return -1;
+    }
+    for (int32_t b = 0; b < num_bins; b++) {
+        if (bins[b] < 0 || bins[b] >= N) {
+            return -1;
+        }
+        sdft->bins[b] = bins[b];
+    }
+    sdft->N = N;
+    sdft->num_bins = num_bins;
+    sdft->history = history;
+    sdft->twiddle = twiddle;
+    memset(history, 0, sizeof(int32_t) * N);
+
+    for (int32_t t = 0; t < N; t++) {
+        int32_t s, c;
+        cordic_sincos((int32_t)(((int64_t)t * (360 << CORDIC_MATH_FRACTION_BITS)) / N), &s, &c);
+        twiddle[t].real = CORDIC_TO_FFT(c);
+        twiddle[t].imag = -CORDIC_TO_FFT(s);
+    }
+    return 0;
+}
+
+/**
+ * @brief Slides the window over new samples.
+ *
+ * @param sdft the SlidingDft.
+ * @param samples fixedpoint samples according to FFT_MATH_FRACTION_BITS.
+ * @param count the number of samples, any size.
+ *
+ * @return 0
+ */
+int32_t sliding_dft_push(SlidingDft *sdft, const int32_t samples[], int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        /* The new sample shares the slot, and the twiddle, of the one it replaces */
+        int64_t d = (int64_t)samples[i] - sdft->history[sdft->pos];
+        sdft->history[sdft->pos] = samples[i];
+
+        for (int32_t b = 0; b < sdft->num_bins; b++) {
+            const Complex *w = &sdft->twiddle[sdft->phase[b]];
+            sdft->acc_real[b] += d * w->real;
+            sdft->acc_imag[b] += d * w->imag;
+            sdft->phase[b] += sdft->bins[b];
+            if (sdft->phase[b] >= sdft->N) {
+                sdft->phase[b] -= sdft->N;
+            }
+        }
+        if (++sdft->pos == sdft->N) {
+            sdft->pos = 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief The DFT of the last N samples, with the oldest sample as index 0,
+ * for every tracked bin.
+ *
+ * @param sdft the SlidingDft.
+ * @param out array of num_bins values, fixedpoint according to
+ * FFT_MATH_FRACTION_BITS with the same scale as fft().
+ *
+ * @return 0
+ */
+int32_t sliding_dft_bins(const SlidingDft *sdft, Complex out[]) {
+    for (int32_t b = 0; b < sdft->num_bins; b++) {
+        /* The accumulator is referenced to sample 0, rotate by W^(-k*pos) */
+        const Complex *w = &sdft->twiddle[sdft->phase[b]];
+        int64_t re = sdft->acc_real[b] >> FFT_MATH_FRACTION_BITS;
+        int64_t im = sdft->acc_imag[b] >> FFT_MATH_FRACTION_BITS;
+        out[b].real = (int)((re * w->real + im * w->imag) >> FFT_MATH_FRACTION_BITS);
+        out[b].imag = (int)((im * w->real - re * w->imag) >> FFT_MATH_FRACTION_BITS);
+    }
+    return 0;
+}
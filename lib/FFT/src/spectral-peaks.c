@@ -0,0 +1,203 @@
+#include <stddef.h>
+
+#include "spectral-peaks.h"
+#include "cordic-math.h"
+
+#if FFT_MATH_FRACTION_BITS >= CORDIC_MATH_FRACTION_BITS
+#define CORDIC_TO_FFT(x) ((x) << (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#else
+#define CORDIC_TO_FFT(x) ((x) >> (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#endif
+
+#define PEAKS_ONE (1 << FFT_MATH_FRACTION_BITS)
+#define DEGREES_360 ((int64_t)360 << FFT_MATH_FRACTION_BITS)
+
+/**
+ * @brief |X|^2 without overflow, both squares fit in 62 bits.
+ */
+static uint64_t power(Complex x) {
+    return (uint64_t)((int64_t)x.real * x.real) + (uint64_t)((int64_t)x.imag * x.imag);
+}
+
+/**
+ * @brief Magnitude and phase of a bin with one cordic vectoring.
+ */
+static void polar(Complex x, int32_t *magnitude, int32_t *phase) {
+    int32_t angle;
+
+    cordic_vector(x.imag, x.real, magnitude, phase != NULL ? &angle : NULL);
+    if (phase != NULL) {
+        *phase = CORDIC_TO_FFT(angle);
+    }
+}
+
+/**
+ * @brief Parabola through the magnitudes of the peak and its neighbours.
+ *
+ * @return The offset of the vertex from the peak bin, fixedpoint.
+ */
+static int32_t quadratic_offset(const Complex X[], int32_t k, int32_t peak_magnitude) {
+    int32_t left, right;
+    int64_t denominator;
+
+    polar(X[k - 1], &left, NULL);
+    polar(X[k + 1], &right, NULL);
+    denominator = 2 * ((int64_t)left - 2 * (int64_t)peak_magnitude + right);
+    if (denominator >= 0) {
+        return 0;
+    }
+    return (int32_t)((((int64_t)left - right) * PEAKS_ONE) / denominator);
+}
+
+/**
+ * @brief Jacobsen's estimator, Re((X[k-1] - X[k+1]) / (2X[k] - X[k-1] - X[k+1])).
+ * Exact for a single tone without window apart from the noise.
+ *
+ * @return The offset from the peak bin, fixedpoint, limited to half a bin.
+ */
+static int32_t jacobsen_offset(const Complex X[], int32_t k) {
+    int64_t a_re = X[k - 1].real, a_im = X[k - 1].imag;
+    int64_t b_re = X[k].real, b_im = X[k].imag;
+    int64_t c_re = X[k + 1].real, c_im = X[k + 1].imag;
+    int64_t num_re, num_im, den_re, den_im, dot, norm, offset;
+
+    /* Keep the bins below 2^19 so the products below fit in 64 bits */
+    while (a_re >= (1 << 19) || a_re <= -(1 << 19) || a_im >= (1 << 19) || a_im <= -(1 << 19) ||
+           b_re >= (1 << 19) || b_re <= -(1 << 19) || b_im >= (1 << 19) || b_im <= -(1 << 19) ||
+           c_re >= (1 << 19) || c_re <= -(1 << 19) || c_im >= (1 << 19) || c_im <= -(1 << 19)) {
+        a_re >>= 1;
+        a_im >>= 1;
+        b_re >>= 1;
+        b_im >>= 1;
+        c_re >>= 1;
+        c_im >>= 1;
+    }
+    num_re = a_re - c_re;
+    num_im = a_im - c_im;
+    den_re = 2 * b_re - a_re - c_re;
+    den_im = 2 * b_im - a_im - c_im;
+    dot = num_re * den_re + num_im * den_im;
+    norm = den_re * den_re + den_im * den_im;
+    if (norm == 0) {
+        return 0;
+    }
+    offset = (dot * PEAKS_ONE) / norm;
+    if (offset > PEAKS_ONE / 2) {
+        offset = PEAKS_ONE / 2;
+    } else if (offset < -PEAKS_ONE / 2) {
+        offset = -PEAKS_ONE / 2;
+    }
+    return (int32_t)offset;
+}
+
+/**
+ * @brief Finds the largest local maxima of a spectrum and refines their
+ * frequency. The scan only compares squared magnitudes, the cordic and the
+ * interpolation run for the peaks that are returned, so the refinement is
+ * O(max_peaks) per frame instead of a zero padded FFT.
+ *
+ * @param X the FFT bins.
+ * @param bins the number of bins to search, N/2 for a real signal. Bin 0
+ * and bin bins - 1 are never peaks, they lack a neighbour.
+ * @param threshold the smallest magnitude |X| a peak can have.
+ * @param max_peaks the number of peaks to return, at most SPECTRAL_PEAKS_MAX.
+ * @param interpolation how the frequency between the bins is estimated,
+ * Jacobsen suits the rectangular window, the parabola the smooth windows.
+ * @param peaks the peaks, the largest first.
+ *
+ * @return The number of peaks found, -1 if the arguments are invalid.
+ */
+int32_t spectral_peaks_find(const Complex X[], int32_t bins, int32_t threshold,
+                            int32_t max_peaks, SpectralPeakInterpolation interpolation,
+                            SpectralPeak peaks[]) {
+    uint64_t found_power[SPECTRAL_PEAKS_MAX];
+    uint64_t limit = (uint64_t)((int64_t)threshold * threshold);
+    uint64_t previous, current, next;
+    int32_t count = 0;
+
+    if (bins < 0 || threshold < 0 || max_peaks < 1 || max_peaks > SPECTRAL_PEAKS_MAX) {
+        return -1;
+    }
+    if (bins < 3) {
+        return 0;
+    }
+
+    previous = power(X[0]);
+    current = power(X[1]);
+    for (int32_t k = 1; k < bins - 1; k++) {
+        next = power(X[k + 1]);
+        if (current > previous && current >= next && current >= limit &&
+            (count < max_peaks || current > found_power[count - 1])) {
+            /* Insert into the list that is sorted by power */
+            int32_t i = count < max_peaks ? count++ : count - 1;
+            while (i > 0 && found_power[i - 1] < current) {
+                found_power[i] = found_power[i - 1];
+                peaks[i] = peaks[i - 1];
+                i--;
+            }
+            found_power[i] = current;
+            peaks[i].bin = k;
+        }
+        previous = current;
+        current = next;
+    }
+
+    for (int32_t i = 0; i < count; i++) {
+        int32_t k = peaks[i].bin, offset = 0;
+
+        polar(X[k], &peaks[i].magnitude, &peaks[i].phase);
+        switch (interpolation) {
+        case SPECTRAL_PEAKS_QUADRATIC:
+            offset = quadratic_offset(X, k, peaks[i].magnitude);
+            break;
+        case SPECTRAL_PEAKS_JACOBSEN:
+            offset = jacobsen_offset(X, k);
+            break;
+        case SPECTRAL_PEAKS_NONE:
+        default:
+            break;
+        }
+        peaks[i].frequency = k * PEAKS_ONE + offset;
+    }
+    return count;
+}
+
+/**
+ * @brief Phase vocoder refinement of the peak frequencies from two frames
+ * hop samples apart. The phase of a tone advances by 360 * f * hop / N
+ * degrees between the frames, the deviation from the advance of the bin
+ * centre gives the frequency. Only the peak bins are read, O(count).
+ *
+ * @param previous the bins of the earlier frame.
+ * @param current the bins of the later frame, the peaks were found here.
+ * @param N the FFT size.
+ * @param hop the number of samples between the frames, the result is
+ * unambiguous within N / (2 * hop) bins of the peak bin.
+ * @param peaks the peaks, frequency and phase are updated.
+ * @param count the number of peaks.
+ *
+ * @return 0 on success, -1 if the arguments are invalid.
+ */
+int32_t spectral_peaks_vocoder(const Complex previous[], const Complex current[], int32_t N,
+                               int32_t hop, SpectralPeak peaks[], int32_t count) {
+    if (N < 1 || hop < 1 || count < 0) {
+        return -1;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        int32_t k = peaks[i].bin, before, now;
+        int64_t expected, deviation;
+
+        polar(previous[k], NULL, &before);
+        polar(current[k], NULL, &now);
+        expected = (((int64_t)k * hop % N) * DEGREES_360) / N;
+        deviation = ((int64_t)now - before - expected) % DEGREES_360;
+        if (deviation > DEGREES_360 / 2) {
+            deviation -= DEGREES_360;
+        } else if (deviation <= -DEGREES_360 / 2) {
+            deviation += DEGREES_360;
+        }
+        peaks[i].phase = now;
+        peaks[i].frequency = k * PEAKS_ONE + (int32_t)((deviation * N) / (360 * (int64_t)hop));
+    }
+    return 0;
+}
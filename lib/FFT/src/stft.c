@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "stft.h"
+#include "cordic-math.h"
+
+#define FLOAT_TO_INT(x) ((x) >= 0 ? (int)((x) + 0.5) : (int)((x)-0.5))
+
+#if FFT_MATH_FRACTION_BITS >= CORDIC_MATH_FRACTION_BITS
+#define CORDIC_TO_FFT(x) ((x) << (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#else
+#define CORDIC_TO_FFT(x) ((x) >> (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#endif
+
+#define STFT_ONE (1 << FFT_MATH_FRACTION_BITS)
+
+/**
+ * @brief cos(2*pi*k*n/N) with the cordic algorithm.
+ *
+ * @return fixedpoint according to FFT_MATH_FRACTION_BITS
+ */
+static int32_t window_cos(int32_t k, int32_t n, int32_t N) {
+    int32_t s, c;
+    int64_t turns = ((int64_t)k * n) % N;
+    cordic_sincos((int32_t)((turns * (360 << CORDIC_MATH_FRACTION_BITS)) / N), &s, &c);
+    return CORDIC_TO_FFT(c);
+}
+
+/**
+ * @brief Fills the window table, the periodic form of the windows is used
+ * since the frames overlap.
+ */
+static void window_fill(int32_t window[], int32_t N, StftWindow type) {
+    static const int32_t HALF = FLOAT_TO_INT(0.50 * STFT_ONE);
+    static const int32_t HAMMING_A0 = FLOAT_TO_INT(0.54 * STFT_ONE);
+    static const int32_t HAMMING_A1 = FLOAT_TO_INT(0.46 * STFT_ONE);
+    static const int32_t BLACKMAN_A0 = FLOAT_TO_INT(0.42 * STFT_ONE);
+    static const int32_t BLACKMAN_A2 = FLOAT_TO_INT(0.08 * STFT_ONE);
+
+    for (int32_t n = 0; n < N; n++) {
+        int64_t c1, c2;
+        switch (type) {
+        case STFT_WINDOW_HANN:
+            c1 = window_cos(1, n, N);
+            window[n] = HALF - (int32_t)((HALF * c1) >> FFT_MATH_FRACTION_BITS);
+            break;
+        case STFT_WINDOW_HAMMING:
+            c1 = window_cos(1, n, N);
+            window[n] = HAMMING_A0 - (int32_t)((HAMMING_A1 * c1) >> FFT_MATH_FRACTION_BITS);
+            break;
+        case STFT_WINDOW_BLACKMAN:
+            c1 = window_cos(1, n, N);
+            c2 = window_cos(2, n, N);
+            window[n] = BLACKMAN_A0 - (int32_t)((HALF * c1) >> FFT_MATH_FRACTION_BITS) +
+                        (int32_t)((BLACKMAN_A2 * c2) >> FFT_MATH_FRACTION_BITS);
+            break;
+        case STFT_WINDOW_RECTANGULAR:
+        default:
+            window[n] = STFT_ONE;
+            break;
+        }
+        /* The cordic result can overshoot by a few bits at the ends */
+        if (window[n] < 0) {
+            window[n] = 0;
+        } else if (window[n] > STFT_ONE) {
+            window[n] = STFT_ONE;
+        }
+    }
+}
+
+/**
+ * @brief Windows the buffered samples from oldest to newest into the frame,
+ * runs the FFT and hands the spectrum to the callback.
+ */
+static void stft_emit(Stft *stft) {
+    int32_t N = stft->frame_size;
+    int32_t first = N - stft->write_pos;
+    const int32_t *w = stft->window;
+
+    for (int32_t n = 0; n < first; n++) {
+        stft->frame[n].real =
+            (int)(((int64_t)stft->ring[stft->write_pos + n] * w[n]) >> FFT_MATH_FRACTION_BITS);
+        stft->frame[n].imag = 0;
+    }
+    for (int32_t n = first; n < N; n++) {
+        stft->frame[n].real =
+            (int)(((int64_t)stft->ring[n - first] * w[n]) >> FFT_MATH_FRACTION_BITS);
+        stft->frame[n].imag = 0;
+    }
+
+    fft_plan_execute(stft->plan, stft->frame);
+    stft->callback(stft->frame, N, stft->user);
+}
+
+/**
+ * @brief Sets up a streaming short-time Fourier transform. All memory is
+ * allocated here and the window is calculated once with the cordic
+ * algorithm, stft_push() does not allocate.
+ *
+ * @param stft the Stft to set up.
+ * @param frame_size the number of samples in every frame, any length
+ * supported by fft_plan_create().
+ * @param hop the number of new samples between two frames, hop < frame_size
+ * gives overlapping frames.
+ * @param window the window applied to every frame.
+ * @param callback called with the spectrum of every frame.
+ * @param user passed on to the callback.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t stft_init(Stft *stft, int32_t frame_size, int32_t hop, StftWindow window,
+                  StftFrameCallback callback, void *user) {
+    memset(stft, 0, sizeof(Stft));
+    if (frame_size < 1 || hop < 1 || callback == NULL) {
+        return -1;
+    }
+    stft->frame_size = frame_size;
+    stft->hop = hop;
+    stft->callback = callback;
+    stft->user = user;
+    stft->window = malloc(sizeof(int32_t) * frame_size);
+    stft->ring = malloc(sizeof(int32_t) * frame_size);
+    stft->frame = malloc(sizeof(Complex) * frame_size);
+    stft->plan = fft_plan_create(frame_size);
+    if (stft->window == NULL || stft->ring == NULL || stft->frame == NULL ||
+        stft->plan == NULL) {
+        stft_free(stft);
+        return -1;
+    }
+    window_fill(stft->window, frame_size, window);
+    stft_reset(stft);
+    return 0;
+}
+
+/**
+ * @brief Feeds samples into the Stft, the callback is called for every
+ * frame that gets completed by these samples.
+ *
+ * @param stft the Stft.
+ * @param samples fixedpoint samples according to FFT_MATH_FRACTION_BITS.
+ * @param count the number of samples, any size.
+ *
+ * @return The number of frames emitted.
+ */
+int32_t stft_push(Stft *stft, const int32_t samples[], int32_t count) {
+    int32_t frames = 0;
+    int32_t N = stft->frame_size;
+
+    while (count > 0) {
+        /* Copy as much as possible before the ring wraps or a frame is due */
+        int32_t n = count;
+        if (n > stft->until_next) {
+            n = stft->until_next;
+        }
+        if (n > N - stft->write_pos) {
+            n = N - stft->write_pos;
+        }
+        memcpy(&stft->ring[stft->write_pos], samples, sizeof(int32_t) * n);
+        samples += n;
+        count -= n;
+        stft->write_pos += n;
+        if (stft->write_pos == N) {
+            stft->write_pos = 0;
+        }
+        stft->until_next -= n;
+
+        if (stft->until_next == 0) {
+            stft_emit(stft);
+            stft->until_next = stft->hop;
+            frames++;
+        }
+    }
+    return frames;
+}
+
+/**
+ * @brief Drops all buffered samples, the next frame is emitted once
+ * frame_size new samples have been pushed.
+ */
+void stft_reset(Stft *stft) {
+    stft->write_pos = 0;
+    stft->until_next = stft->frame_size;
+}
+
+/**
+ * @brief Frees the memory allocated by stft_init().
+ */
+void stft_free(Stft *stft) {
+    free(stft->window);
+    free(stft->ring);
+    free(stft->frame);
+    fft_plan_destroy(stft->plan);
+    stft->window = NULL;
+    stft->ring = NULL;
+    stft->frame = NULL;
+    stft->plan = NULL;
+}
@@ -0,0 +1,257 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "thread-pool.h"
+
+/*
+ * Every worker owns a range of loop items packed as (begin << 32) | end in
+ * one atomic word. The owner takes grain sized chunks from the front and an
+ * idle worker steals the back half of another worker's range, both with
+ * a single compare and swap, so no locks are taken while a loop runs.
+ */
+#define RANGE_PACK(begin, end) (((uint64_t)(uint32_t)(begin) << 32) | (uint32_t)(end))
+#define RANGE_BEGIN(range) ((int32_t)((range) >> 32))
+#define RANGE_END(range) ((int32_t)((range) & 0xFFFFFFFFu))
+
+typedef struct {
+    _Atomic uint64_t range;
+    char pad[64 - sizeof(uint64_t)]; /* one cache line per worker */
+} WorkerRange;
+
+struct ThreadPool {
+    int32_t threads;
+    pthread_t *handles;
+    WorkerRange *ranges;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    uint64_t generation;
+    int32_t shutdown;
+    ThreadPoolTask task;
+    void *ctx;
+    int32_t grain;
+    _Atomic int32_t remaining; /* items not yet processed */
+    _Atomic int32_t active;    /* workers that may still touch the ranges */
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int32_t index;
+} WorkerArg;
+
+/**
+ * @brief Takes the next chunk from the worker's own range.
+ *
+ * @return 1 if a chunk was taken, 0 if the range is empty.
+ */
+static int32_t take_own(ThreadPool *pool, int32_t self, int32_t *begin, int32_t *end) {
+    uint64_t range = atomic_load(&pool->ranges[self].range);
+
+    while (RANGE_BEGIN(range) < RANGE_END(range)) {
+        int32_t b = RANGE_BEGIN(range), e = RANGE_END(range);
+        int32_t n = (e - b < pool->grain) ? e - b : pool->grain;
+        if (atomic_compare_exchange_weak(&pool->ranges[self].range, &range,
+                                         RANGE_PACK(b + n, e))) {
+            *begin = b;
+            *end = b + n;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Steals the back half of another worker's range into the own range.
+ *
+ * @return 1 if something was stolen, 0 if every range is empty.
+ */
+static int32_t steal(ThreadPool *pool, int32_t self) {
+    for (int32_t k = 1; k < pool->threads; k++) {
+        int32_t victim = (self + k) % pool->threads;
+        uint64_t range = atomic_load(&pool->ranges[victim].range);
+
+        while (RANGE_BEGIN(range) < RANGE_END(range)) {
+            int32_t b = RANGE_BEGIN(range), e = RANGE_END(range);
+            int32_t mid = b + (e - b) / 2; /* a single item is taken whole */
+            if (atomic_compare_exchange_weak(&pool->ranges[victim].range, &range,
+                                             RANGE_PACK(b, mid))) {
+                atomic_store(&pool->ranges[self].range, RANGE_PACK(mid, e));
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs chunks until every range in the pool is empty.
+ */
+static void run_loop(ThreadPool *pool, int32_t self) {
+    int32_t begin, end;
+
+    for (;;) {
+        if (take_own(pool, self, &begin, &end)) {
+            pool->task(begin, end, pool->ctx);
+            atomic_fetch_sub(&pool->remaining, end - begin);
+        } else if (!steal(pool, self)) {
+            break;
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    ThreadPool *pool = ((WorkerArg *)arg)->pool;
+    int32_t self = ((WorkerArg *)arg)->index;
+    uint64_t seen = 0;
+
+    free(arg);
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_loop(pool, self);
+        atomic_fetch_sub(&pool->active, 1);
+    }
+}
+
+/**
+ * @brief Creates a pool of worker threads. The thread calling
+ * thread_pool_parallel_for() works as well, so threads - 1 threads are
+ * started.
+ *
+ * @param threads the total number of threads, values below 1 are set to 1.
+ *
+ * @return Pointer to the pool, NULL if it could not be created.
+ */
+ThreadPool *thread_pool_create(int32_t threads) {
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->threads = threads < 1 ? 1 : threads;
+    pool->handles = calloc(pool->threads, sizeof(pthread_t));
+    pool->ranges = aligned_alloc(64, sizeof(WorkerRange) * pool->threads);
+    if (pool->handles == NULL || pool->ranges == NULL) {
+        free(pool->handles);
+        free(pool->ranges);
+        free(pool);
+        return NULL;
+    }
+    for (int32_t i = 0; i < pool->threads; i++) {
+        atomic_init(&pool->ranges[i].range, 0);
+    }
+    atomic_init(&pool->remaining, 0);
+    atomic_init(&pool->active, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (int32_t i = 1; i < pool->threads; i++) {
+        WorkerArg *arg = malloc(sizeof(WorkerArg));
+        if (arg == NULL) {
+            pool->threads = i;
+            break;
+        }
+        arg->pool = pool;
+        arg->index = i;
+        if (pthread_create(&pool->handles[i], NULL, worker_main, arg) != 0) {
+            free(arg);
+            pool->threads = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+/**
+ * @brief The number of threads that work on a loop, the caller included.
+ */
+int32_t thread_pool_size(const ThreadPool *pool) {
+    return pool == NULL ? 1 : pool->threads;
+}
+
+/**
+ * @brief Runs task over the items [0, count) on all threads of the pool and
+ * returns when every item is processed. The items are split evenly between
+ * the threads, a thread that runs out of work steals half of the work
+ * another thread has left.
+ *
+ * @param pool the pool, NULL runs the loop on the calling thread.
+ * @param count the number of items.
+ * @param grain the number of items a thread takes at a time, 0 picks a
+ * default.
+ * @param task the function that processes a chunk of items.
+ * @param ctx passed on to the task.
+ *
+ * @return 0
+ */
+int32_t thread_pool_parallel_for(ThreadPool *pool, int32_t count, int32_t grain,
+                                 ThreadPoolTask task, void *ctx) {
+    if (count <= 0) {
+        return 0;
+    }
+    if (pool == NULL || pool->threads == 1) {
+        task(0, count, ctx);
+        return 0;
+    }
+    if (grain <= 0) {
+        grain = count / (pool->threads * 8);
+        grain = grain < 1 ? 1 : grain;
+    }
+
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->grain = grain;
+    atomic_store(&pool->remaining, count);
+    atomic_store(&pool->active, pool->threads - 1);
+    for (int32_t i = 0; i < pool->threads; i++) {
+        int32_t begin = (int32_t)((int64_t)count * i / pool->threads);
+        int32_t end = (int32_t)((int64_t)count * (i + 1) / pool->threads);
+        atomic_store(&pool->ranges[i].range, RANGE_PACK(begin, end));
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_loop(pool, 0);
+
+    /* Wait for the chunks still running and for workers still looking for work */
+    while (atomic_load(&pool->remaining) > 0 || atomic_load(&pool->active) > 0) {
+        sched_yield();
+    }
+    return 0;
+}
+
+/**
+ * @brief Stops the worker threads and frees the pool.
+ *
+ * @param pool the pool, NULL is allowed.
+ */
+void thread_pool_destroy(ThreadPool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int32_t i = 1; i < pool->threads; i++) {
+        pthread_join(pool->handles[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->handles);
+    free(pool->ranges);
+    free(pool);
+}
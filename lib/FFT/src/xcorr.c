@@ -0,0 +1,292 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "xcorr.h"
+#include "cordic-math.h"
+
+#if FFT_MATH_FRACTION_BITS >= CORDIC_MATH_FRACTION_BITS
+#define CORDIC_TO_FFT(x) ((x) << (FFT_MATH_FRACTION_BITS - CORDIC_MATH_FRACTION_BITS))
+#else
+#define CORDIC_TO_FFT(x) ((x) >> (CORDIC_MATH_FRACTION_BITS - FFT_MATH_FRACTION_BITS))
+#endif
+
+/**
+ * @brief The GCC-PHAT bins are unit vectors with XCORR_PHAT_BITS fraction
+ * bits before the 1/N, so a perfect match gives a peak of 2^XCORR_PHAT_BITS.
+ */
+#define XCORR_PHAT_BITS 30
+
+/**
+ * @brief One bin of the cross spectrum conj(A) * B, divided by N so the
+ * correlation can be computed with a forward FFT.
+ */
+static Complex cross_bin(const Xcorr *xc, Complex a_conj, Complex b) {
+    int64_t re = (int64_t)a_conj.real * b.real - (int64_t)a_conj.imag * b.imag;
+    int64_t im = (int64_t)a_conj.real * b.imag + (int64_t)a_conj.imag * b.real;
+    Complex y = {0, 0};
+
+    if (xc->weighting == XCORR_WEIGHT_PHAT) {
+        int32_t angle, s, c;
+        /* Only the angle is needed, bring the product into 32 bits first */
+        while (re >= (1 << 30) || re <= -(1 << 30) || im >= (1 << 30) || im <= -(1 << 30)) {
+            re >>= 1;
+            im >>= 1;
+        }
+        if (re == 0 && im == 0) {
+            return y;
+        }
+        cordic_vector((int32_t)im, (int32_t)re, NULL, &angle);
+        cordic_sincos(angle, &s, &c);
+        y.real = (CORDIC_TO_FFT(c) << (XCORR_PHAT_BITS - FFT_MATH_FRACTION_BITS)) >> xc->log2_N;
+        y.imag = (CORDIC_TO_FFT(s) << (XCORR_PHAT_BITS - FFT_MATH_FRACTION_BITS)) >> xc->log2_N;
+        return y;
+    }
+
+    y.real = (int)(re >> (FFT_MATH_FRACTION_BITS + xc->log2_N));
+    y.imag = (int)(im >> (FFT_MATH_FRACTION_BITS + xc->log2_N));
+    return y;
+}
+
+/**
+ * @brief The correlation of xc->cross, the real part holds the first
+ * correlation and the imaginary part the second, in fixedpoint according to
+ * FFT_MATH_FRACTION_BITS. The inverse FFT is conj(FFT(conj(Y))), the 1/N is
+ * already in the bins.
+ */
+static void cross_to_correlation(Xcorr *xc) {
+    int32_t shift = xc->weighting == XCORR_WEIGHT_PHAT ?
+                    XCORR_PHAT_BITS - FFT_MATH_FRACTION_BITS : 0;
+
+    for (int32_t k = 0; k < xc->N; k++) {
+        xc->cross[k].imag = -xc->cross[k].imag;
+    }
+    fft(xc->cross, xc->N);
+    for (int32_t k = 0; k < xc->N; k++) {
+        xc->cross[k].real >>= shift;
+        xc->cross[k].imag = -xc->cross[k].imag >> shift;
+    }
+}
+
+/**
+ * @brief Loads a real signal into xc->spectrum, zero padded to N.
+ */
+static void load_real(Xcorr *xc, const int32_t real[], const int32_t imag[]) {
+    for (int32_t n = 0; n < xc->length; n++) {
+        xc->spectrum[n].real = real[n];
+        xc->spectrum[n].imag = imag != NULL ? imag[n] : 0;
+    }
+    memset(&xc->spectrum[xc->length], 0, sizeof(Complex) * (xc->N - xc->length));
+}
+
+/**
+ * @brief Splits the FFT Z of a + i*b into the spectra of the two real
+ * signals, A[k] = (Z[k] + conj(Z[N-k])) / 2 and
+ * B[k] = (Z[k] - conj(Z[N-k])) / 2i.
+ */
+static void unpack(const Complex Z[], int32_t N, int32_t k, Complex *A, Complex *B) {
+    Complex z = Z[k], zc = Z[(N - k) & (N - 1)];
+
+    A->real = (z.real + zc.real) >> 1;
+    A->imag = (z.imag - zc.imag) >> 1;
+    B->real = (z.imag + zc.imag) >> 1;
+    B->imag = (zc.real - z.real) >> 1;
+}
+
+/**
+ * @brief Finds the largest correlation within +-max_lag and refines it with
+ * a parabola through the peak and its two neighbours.
+ *
+ * @param c the correlation of N lags, lag -l at index N - l.
+ * @param imag 1 to search the imaginary parts.
+ *
+ * @return The delay in samples, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ */
+static int32_t find_peak(const Xcorr *xc, int32_t max_lag, int32_t imag) {
+    int32_t N = xc->N, best = 0;
+    int64_t best_value = 0, left, mid, right, denominator;
+
+    if (max_lag < 0 || max_lag > xc->length - 1) {
+        max_lag = xc->length - 1;
+    }
+    for (int32_t lag = -max_lag; lag <= max_lag; lag++) {
+        const Complex *v = &xc->cross[lag & (N - 1)];
+        int64_t value = imag ? v->imag : v->real;
+        if (lag == -max_lag || value > best_value) {
+            best = lag;
+            best_value = value;
+        }
+    }
+
+    left = imag ? xc->cross[(best - 1) & (N - 1)].imag : xc->cross[(best - 1) & (N - 1)].real;
+    mid = best_value;
+    right = imag ? xc->cross[(best + 1) & (N - 1)].imag : xc->cross[(best + 1) & (N - 1)].real;
+    denominator = 2 * (left - 2 * mid + right);
+    if (denominator >= 0) {
+        return best * (1 << FFT_MATH_FRACTION_BITS);
+    }
+    /* offset = (left - right) / denominator, within half a sample */
+    return best * (1 << FFT_MATH_FRACTION_BITS) +
+           (int32_t)(((left - right) * (1 << FFT_MATH_FRACTION_BITS)) / denominator);
+}
+
+/**
+ * @brief Sets up a cross-correlator for signals of the given length. The
+ * correlation runs in the frequency domain in O(N log N), the FFT size is
+ * the power of two N >= 2 * length so no lags wrap around.
+ *
+ * @param xc the Xcorr to set up.
+ * @param length the number of samples per signal, 1 <= length <= XCORR_MAX_LENGTH.
+ * @param weighting XCORR_WEIGHT_NONE for the plain cross-correlation,
+ * XCORR_WEIGHT_PHAT for GCC-PHAT which gives sharp peaks for broadband
+ * signals and in reverberant rooms.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t xcorr_init(Xcorr *xc, int32_t length, XcorrWeighting weighting) {
+    memset(xc, 0, sizeof(Xcorr));
+    if (length < 1 || length > XCORR_MAX_LENGTH) {
+        return -1;
+    }
+    xc->length = length;
+    xc->weighting = weighting;
+    xc->N = 2;
+    xc->log2_N = 1;
+    while (xc->N < 2 * length) {
+        xc->N <<= 1;
+        xc->log2_N++;
+    }
+    xc->reference = calloc(xc->N, sizeof(Complex));
+    xc->spectrum = malloc(sizeof(Complex) * xc->N);
+    xc->cross = malloc(sizeof(Complex) * xc->N);
+    if (xc->reference == NULL || xc->spectrum == NULL || xc->cross == NULL) {
+        xcorr_free(xc);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Stores the conjugated spectrum of a reference signal, it is used
+ * by xcorr_correlate() and xcorr_delays() until it is replaced.
+ *
+ * @param xc the Xcorr.
+ * @param reference length samples, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ *
+ * @return 0
+ */
+int32_t xcorr_set_reference(Xcorr *xc, const int32_t reference[]) {
+    load_real(xc, reference, NULL);
+    fft(xc->spectrum, xc->N);
+    for (int32_t k = 0; k < xc->N; k++) {
+        xc->reference[k].real = xc->spectrum[k].real;
+        xc->reference[k].imag = -xc->spectrum[k].imag;
+    }
+    return 0;
+}
+
+/**
+ * @brief Cross-correlation of the reference and a signal,
+ * r[lag] = sum reference[n] * signal[n + lag].
+ *
+ * @param xc the Xcorr with a reference.
+ * @param signal length samples, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ * @param correlation 2 * length - 1 values, correlation[length - 1 + lag]
+ * holds r[lag], fixedpoint according to FFT_MATH_FRACTION_BITS. With
+ * GCC-PHAT a perfect match gives a peak of 1.0.
+ *
+ * @return 0
+ */
+int32_t xcorr_correlate(Xcorr *xc, const int32_t signal[], int32_t correlation[]) {
+    load_real(xc, signal, NULL);
+    fft(xc->spectrum, xc->N);
+    for (int32_t k = 0; k < xc->N; k++) {
+        xc->cross[k] = cross_bin(xc, xc->reference[k], xc->spectrum[k]);
+    }
+    cross_to_correlation(xc);
+    for (int32_t lag = -(xc->length - 1); lag < xc->length; lag++) {
+        correlation[xc->length - 1 + lag] = xc->cross[lag & (xc->N - 1)].real;
+    }
+    return 0;
+}
+
+/**
+ * @brief Delays of a batch of signals against the reference. Two signals
+ * share one forward FFT as its real and imaginary part, and their two
+ * correlations share one inverse FFT, so a batch costs one FFT per signal.
+ *
+ * @param xc the Xcorr with a reference.
+ * @param signals count pointers to length samples each.
+ * @param count the number of signals.
+ * @param max_lag the largest delay searched in samples, -1 searches all.
+ * @param delays the delay of every signal relative to the reference in
+ * samples, positive when the signal lags, fixedpoint according to
+ * FFT_MATH_FRACTION_BITS with sub-sample interpolation.
+ *
+ * @return 0
+ */
+int32_t xcorr_delays(Xcorr *xc, const int32_t *const signals[], int32_t count,
+                     int32_t max_lag, int32_t delays[]) {
+    for (int32_t i = 0; i < count; i += 2) {
+        int32_t pair = i + 1 < count;
+        load_real(xc, signals[i], pair ? signals[i + 1] : NULL);
+        fft(xc->spectrum, xc->N);
+
+        for (int32_t k = 0; k < xc->N; k++) {
+            Complex s1, s2, y1, y2;
+            unpack(xc->spectrum, xc->N, k, &s1, &s2);
+            y1 = cross_bin(xc, xc->reference[k], s1);
+            y2 = cross_bin(xc, xc->reference[k], s2);
+            /* Both correlations are real, pack them as y1 + i*y2 */
+            xc->cross[k].real = y1.real - y2.imag;
+            xc->cross[k].imag = y1.imag + y2.real;
+        }
+        cross_to_correlation(xc);
+
+        delays[i] = find_peak(xc, max_lag, 0);
+        if (pair) {
+            delays[i + 1] = find_peak(xc, max_lag, 1);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Delay between two new signals, both spectra come from one FFT of
+ * a + i*b.
+ *
+ * @param xc the Xcorr, its reference is not used or changed.
+ * @param a length samples, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ * @param b length samples, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ * @param max_lag the largest delay searched in samples, -1 searches all.
+ * @param delay pointer where the delay of b relative to a is stored, in
+ * samples, fixedpoint according to FFT_MATH_FRACTION_BITS.
+ *
+ * @return 0
+ */
+int32_t xcorr_pair_delay(Xcorr *xc, const int32_t a[], const int32_t b[], int32_t max_lag,
+                         int32_t *delay) {
+    load_real(xc, a, b);
+    fft(xc->spectrum, xc->N);
+    for (int32_t k = 0; k < xc->N; k++) {
+        Complex A, B;
+        unpack(xc->spectrum, xc->N, k, &A, &B);
+        A.imag = -A.imag;
+        xc->cross[k] = cross_bin(xc, A, B);
+    }
+    cross_to_correlation(xc);
+    *delay = find_peak(xc, max_lag, 0);
+    return 0;
+}
+
+/**
+ * @brief Frees the memory allocated by xcorr_init().
+ */
+void xcorr_free(Xcorr *xc) {
+    free(xc->reference);
+    free(xc->spectrum);
+    free(xc->cross);
+    xc->reference = NULL;
+    xc->spectrum = NULL;
+    xc->cross = NULL;
+}
@@ -0,0 +1,619 @@
+// Benchmarks for the FFT library.
+//
+// Build from the lib folder:
+//   gcc -O2 -IcordicMath/include -IFFT/include FFT_benchmark.c FFT/src/*.c cordicMath/src/*.c -o fft_benchmark -lpthread
+//
+// Timings are wall clock. To see the cache behaviour directly run it under
+//   perf stat -e cache-misses,dTLB-load-misses ./fft_benchmark
+//
+// The out of core FFT writes its files into the current folder, up to
+// 2^24 values (128 MiB plus 256 MiB) by default. Larger sizes are opt-in:
+//   ./fft_benchmark 30
+// runs up to 2^30, 8 GiB of input and 16 GiB of output.
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fft.h"
+#include "fft-parallel.h"
+#include "fast-convolution.h"
+#include "fft-spectrum.h"
+#include "fft-out-of-core.h"
+#include "xcorr.h"
+#include "spectral-peaks.h"
+#include "cordic-math.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill_signal(Complex x[], int32_t N) {
+    for (int32_t n = 0; n < N; n++) {
+        x[n].real = (int32_t)(((int64_t)n * 7919) % 4096 - 2048);
+        x[n].imag = 0;
+    }
+}
+
+// The bit reversal loop fft() used before the blocked version
+static void naive_bit_reverse(Complex x[], int32_t N) {
+    int i, j, k, l, ip;
+    Complex t;
+
+    l = N >> 1;
+    j = l;
+    ip = N - 2;
+    for (i = 1; i <= ip; i++) {
+        if (i < j) {
+            t = x[j];
+            x[j] = x[i];
+            x[i] = t;
+        }
+        k = l;
+        while (k <= j) {
+            j = j - k;
+            k = k >> 1;
+        }
+        j = j + k;
+    }
+}
+
+static void benchmark_fft_variants(void) {
+    printf("Bit reversal and radix-2 FFT, ms per call\n");
+    printf("%-10s %14s %14s %14s %14s\n", "N", "naive bitrev",
+           "blocked bitrev", "fft()", "fft_stockham");
+    for (int32_t log2n = 10; log2n <= 22; log2n += 2) {
+        int32_t N = 1 << log2n;
+        int32_t runs = (1 << 24) / N;
+        Complex *x = malloc(sizeof(Complex) * N);
+        Complex *work = malloc(sizeof(Complex) * N);
+        double t0, t_naive, t_blocked, t_fft, t_stockham;
+
+        fill_signal(x, N);
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            naive_bit_reverse(x, N);
+        }
+        t_naive = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fft_bit_reverse(x, N);
+        }
+        t_blocked = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft(x, N);
+        }
+        t_fft = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft_stockham(x, work, N);
+        }
+        t_stockham = (now_seconds() - t0) / runs;
+
+        printf("2^%-8d %14.3f %14.3f %14.3f %14.3f\n", log2n, t_naive * 1e3,
+               t_blocked * 1e3, t_fft * 1e3, t_stockham * 1e3);
+        free(x);
+        free(work);
+    }
+    printf("\n");
+}
+
+static void benchmark_q15(void) {
+    printf("Block floating point Q15 FFT, ms per call\n");
+    printf("%-10s %14s %14s %14s\n", "N", "fft()", "fft_q15()", "exponent");
+    for (int32_t log2n = 10; log2n <= 20; log2n += 2) {
+        int32_t N = 1 << log2n;
+        int32_t runs = (1 << 24) / N;
+        int32_t exponent = 0;
+        Complex *x = malloc(sizeof(Complex) * N);
+        ComplexQ15 *x15 = malloc(sizeof(ComplexQ15) * N);
+        double t0, t_fft, t_q15;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft(x, N);
+        }
+        t_fft = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            for (int32_t n = 0; n < N; n++) {
+                x15[n].real = (int16_t)(((int64_t)n * 7919) % 65536 - 32768);
+                x15[n].imag = 0;
+            }
+            fft_q15(x15, N, &exponent);
+        }
+        t_q15 = (now_seconds() - t0) / runs;
+
+        printf("2^%-8d %14.3f %14.3f %14d\n", log2n, t_fft * 1e3, t_q15 * 1e3,
+               exponent);
+        free(x);
+        free(x15);
+    }
+    printf("\n");
+}
+
+// The three pass inverse transform inverse_fft() used before the fused version
+static void three_pass_inverse_fft(Complex x[], int32_t N) {
+    for (int32_t k = 0; k < N; k++) {
+        x[k].imag = -x[k].imag;
+    }
+    fft(x, N);
+    for (int32_t k = 0; k < N; k++) {
+        x[k].real = x[k].real / N;
+        x[k].imag = -x[k].imag / N;
+    }
+}
+
+static void benchmark_inverse(void) {
+    printf("Inverse FFT, ms per call\n");
+    printf("%-10s %14s %14s\n", "N", "three pass", "inverse_fft()");
+    for (int32_t log2n = 8; log2n <= 18; log2n += 2) {
+        int32_t N = 1 << log2n;
+        int32_t runs = (1 << 24) / N;
+        Complex *x = malloc(sizeof(Complex) * N);
+        double t0, t_old, t_new;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            three_pass_inverse_fft(x, N);
+        }
+        t_old = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            inverse_fft(x, N);
+        }
+        t_new = (now_seconds() - t0) / runs;
+
+        printf("2^%-8d %14.3f %14.3f\n", log2n, t_old * 1e3, t_new * 1e3);
+        free(x);
+    }
+    printf("\n");
+}
+
+static void benchmark_four_step(void) {
+    int32_t threads[] = {1, 2, 4, 8};
+
+    printf("Four-step FFT, ms per call\n");
+    printf("%-10s %14s", "N", "fft()");
+    for (int32_t t = 0; t < 4; t++) {
+        printf("    %2d threads", threads[t]);
+    }
+    printf("\n");
+    for (int32_t log2n = 18; log2n <= 24; log2n += 2) {
+        int32_t N = 1 << log2n;
+        int32_t runs = (1 << 26) / N;
+        Complex *x = malloc(sizeof(Complex) * N);
+        double t0;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft(x, N);
+        }
+        printf("2^%-8d %14.3f", log2n, (now_seconds() - t0) / runs * 1e3);
+
+        for (int32_t t = 0; t < 4; t++) {
+            ThreadPool *pool = thread_pool_create(threads[t]);
+            FftFourStep *plan = fft_four_step_create(N, pool);
+
+            t0 = now_seconds();
+            for (int32_t r = 0; r < runs; r++) {
+                fill_signal(x, N);
+                fft_four_step_execute(plan, x);
+            }
+            printf(" %14.3f", (now_seconds() - t0) / runs * 1e3);
+            fft_four_step_destroy(plan);
+            thread_pool_destroy(pool);
+        }
+        printf("\n");
+        free(x);
+    }
+    printf("\n");
+}
+
+// The row by row version with the columns copied out by hand
+static void naive_fft2d(Complex x[], Complex column[], int32_t rows, int32_t cols) {
+    for (int32_t r = 0; r < rows; r++) {
+        fft(&x[r * cols], cols);
+    }
+    for (int32_t c = 0; c < cols; c++) {
+        for (int32_t r = 0; r < rows; r++) {
+            column[r] = x[r * cols + c];
+        }
+        fft(column, rows);
+        for (int32_t r = 0; r < rows; r++) {
+            x[r * cols + c] = column[r];
+        }
+    }
+}
+
+static void benchmark_fft2d(void) {
+    ThreadPool *pool = thread_pool_create(4);
+
+    printf("2D FFT, ms per call\n");
+    printf("%-12s %14s %14s %14s\n", "size", "naive", "fft2d()", "fft2d() 4 thr");
+    for (int32_t log2n = 8; log2n <= 12; log2n++) {
+        int32_t side = 1 << log2n;
+        int32_t N = side * side;
+        int32_t runs = (1 << 24) / N;
+        Complex *x = malloc(sizeof(Complex) * N);
+        Complex *work = malloc(sizeof(Complex) * N);
+        double t0, t_naive, t_tiled, t_pool;
+
+        runs = runs < 1 ? 1 : runs;
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            naive_fft2d(x, work, side, side);
+        }
+        t_naive = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft2d(x, work, side, side, NULL);
+        }
+        t_tiled = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft2d(x, work, side, side, pool);
+        }
+        t_pool = (now_seconds() - t0) / runs;
+
+        printf("%5d x %-5d %14.3f %14.3f %14.3f\n", side, side, t_naive * 1e3, t_tiled * 1e3,
+               t_pool * 1e3);
+        free(x);
+        free(work);
+    }
+    printf("\n");
+    thread_pool_destroy(pool);
+}
+
+// Direct form FIR over a linear history buffer, history holds taps - 1 old
+// samples followed by the new ones
+static void direct_fir(const int32_t h[], int32_t taps, const int32_t history[], int32_t out[],
+                       int32_t count) {
+    for (int32_t n = 0; n < count; n++) {
+        const int32_t *x = &history[n + taps - 1];
+        int64_t acc = 0;
+        for (int32_t k = 0; k < taps; k++) {
+            acc += (int64_t)h[k] * x[-k];
+        }
+        out[n] = (int32_t)(acc >> FFT_MATH_FRACTION_BITS);
+    }
+}
+
+// The largest difference of the FFT output to the direct form. The FFT
+// output is one block late, the direct output starts taps - 1 samples in
+static int32_t convolution_error(const int32_t direct[], int32_t count, const int32_t out[],
+                                 int32_t samples, int32_t delay) {
+    int32_t error = 0;
+
+    for (int32_t n = 0; n < count && n + delay < samples; n++) {
+        int32_t e = abs(out[n + delay] - direct[n]);
+        error = e > error ? e : error;
+    }
+    return error;
+}
+
+static void benchmark_fast_convolution(void) {
+    const int32_t samples = 1 << 16;
+
+    printf("FIR filter, ns per sample, largest error against the direct form in LSB\n");
+    printf("%-8s %8s %14s %14s %14s %10s\n", "taps", "FFT", "direct", "overlap-save",
+           "overlap-add", "error");
+    for (int32_t taps = 16; taps <= 8192; taps *= 2) {
+        int32_t *h = malloc(sizeof(int32_t) * taps);
+        int32_t *in = malloc(sizeof(int32_t) * (samples + taps));
+        int32_t *out = malloc(sizeof(int32_t) * samples);
+        int32_t *direct = malloc(sizeof(int32_t) * samples);
+        int32_t count = samples >> (taps >= 1024 ? 3 : 0), error_save, error_add;
+        double t0, t_direct, t_save, t_add;
+        FastConvolution conv;
+
+        for (int32_t k = 0; k < taps; k++) {
+            h[k] = (1 << FFT_MATH_FRACTION_BITS) / taps;
+        }
+        // A half scale tone the filter passes, with noise it removes
+        for (int32_t n = 0; n < samples + taps; n++) {
+            in[n] = (cordic_sin((n % 65536) * 360) >> 1) + (n * 7919) % 4096 - 2048;
+        }
+
+        // Fewer direct samples for long filters, the time is per sample
+        t0 = now_seconds();
+        direct_fir(h, taps, in, direct, count);
+        t_direct = (now_seconds() - t0) / count;
+
+        fast_convolution_init(&conv, h, taps, 0, FAST_CONVOLUTION_OVERLAP_SAVE);
+        t0 = now_seconds();
+        fast_convolution_process(&conv, in, out, samples);
+        t_save = (now_seconds() - t0) / samples;
+        error_save = convolution_error(direct, count, out, samples, conv.block + taps - 1);
+        fast_convolution_free(&conv);
+
+        fast_convolution_init(&conv, h, taps, 0, FAST_CONVOLUTION_OVERLAP_ADD);
+        t0 = now_seconds();
+        fast_convolution_process(&conv, in, out, samples);
+        t_add = (now_seconds() - t0) / samples;
+        error_add = convolution_error(direct, count, out, samples, conv.block + taps - 1);
+
+        printf("%-8d %8d %14.1f %14.1f %14.1f %10d\n", taps, conv.fft_size, t_direct * 1e9,
+               t_save * 1e9, t_add * 1e9, error_save > error_add ? error_save : error_add);
+        fast_convolution_free(&conv);
+        free(h);
+        free(in);
+        free(out);
+        free(direct);
+    }
+    printf("\n");
+}
+
+// Magnitude, phase and scaling as three separate passes over the bins
+static void three_pass_spectrum(const Complex X[], int32_t N, int32_t out[], int32_t phase[]) {
+    for (int32_t k = 0; k < N / 2; k++) {
+        out[k] = cordic_hypotenuse(X[k].imag, X[k].real);
+    }
+    for (int32_t k = 0; k < N / 2; k++) {
+        phase[k] = cordic_atan(X[k].imag, X[k].real);
+    }
+    out[0] = out[0] / N;
+    for (int32_t k = 1; k < N / 2; k++) {
+        out[k] = 2 * out[k] / N;
+    }
+}
+
+static void benchmark_spectrum(void) {
+    printf("Magnitude and phase of N/2 bins after the FFT, ms per call\n");
+    printf("%-10s %14s %14s\n", "N", "three pass", "fused");
+    for (int32_t log2n = 10; log2n <= 20; log2n += 2) {
+        int32_t N = 1 << log2n;
+        int32_t runs = (1 << 22) / N;
+        Complex *x = malloc(sizeof(Complex) * N);
+        int32_t *out = malloc(sizeof(int32_t) * N / 2);
+        int32_t *phase = malloc(sizeof(int32_t) * N / 2);
+        double t0, t_old, t_new;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft(x, N);
+            three_pass_spectrum(x, N, out, phase);
+        }
+        t_old = (now_seconds() - t0) / runs;
+
+        t0 = now_seconds();
+        for (int32_t r = 0; r < runs; r++) {
+            fill_signal(x, N);
+            fft_spectrum(x, N, N / 2, FFT_SPECTRUM_MAGNITUDE_PHASE, out, phase);
+        }
+        t_new = (now_seconds() - t0) / runs;
+
+        printf("2^%-8d %14.3f %14.3f\n", log2n, t_old * 1e3, t_new * 1e3);
+        free(x);
+        free(out);
+        free(phase);
+    }
+    printf("\n");
+}
+
+// Writes a file to the disk and drops it from the page cache
+static void drop_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+
+    if (fd >= 0) {
+        fsync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+// The input starts out of the page cache, and at 2^30 (8 GiB plus 16 GiB
+// of output) the files are larger than the page cache of most machines, so
+// the transform runs at the speed of the disk
+static void benchmark_out_of_core(int32_t max_log2) {
+    const char *in_path = "fft_benchmark_in.bin";
+    const char *out_path = "fft_benchmark_out.bin";
+    const int32_t chunk = 1 << 16;
+    Complex *x = malloc(sizeof(Complex) * chunk);
+
+    printf("Out of core FFT with a 16 MiB budget, five passes over the file\n");
+    printf("%-10s %10s %14s %14s\n", "N", "MiB", "seconds", "MiB/s");
+    for (int32_t log2n = 22; log2n <= max_log2; log2n += 2) {
+        int64_t N = (int64_t)1 << log2n;
+        double mib = N * sizeof(Complex) / (1024.0 * 1024.0);
+        FILE *file = fopen(in_path, "wb");
+        double t0, t;
+
+        if (file == NULL) {
+            break;
+        }
+        for (int64_t n = 0; n < N; n += chunk) {
+            fill_signal(x, chunk);
+            fwrite(x, sizeof(Complex), chunk, file);
+        }
+        fclose(file);
+        drop_cache(in_path);
+
+        t0 = now_seconds();
+        if (fft_out_of_core(in_path, out_path, N, 16 << 20, NULL) != 0) {
+            printf("2^%-8d %10.0f failed, not enough disk space?\n", log2n, mib);
+            break;
+        }
+        t = now_seconds() - t0;
+        // Every pass reads and writes the whole file once
+        printf("2^%-8d %10.0f %14.3f %14.1f\n", log2n, mib, t, 10 * mib / t);
+    }
+    remove(in_path);
+    remove(out_path);
+    free(x);
+    printf("\n");
+}
+
+// Brute force delay search over every lag
+static int32_t brute_force_delay(const int32_t a[], const int32_t b[], int32_t length) {
+    int64_t best_value = 0;
+    int32_t best = 0;
+
+    for (int32_t lag = -(length - 1); lag < length; lag++) {
+        int64_t sum = 0;
+        for (int32_t n = lag < 0 ? -lag : 0; n < length && n + lag < length; n++) {
+            sum += (int64_t)a[n] * b[n + lag];
+        }
+        if (lag == -(length - 1) || sum > best_value) {
+            best_value = sum;
+            best = lag;
+        }
+    }
+    return best;
+}
+
+static void benchmark_xcorr(void) {
+    const int32_t count = 16;
+
+    printf("Delay of %d signals against one reference, ms per batch\n", count);
+    printf("%-10s %14s %14s\n", "length", "brute force", "xcorr_delays()");
+    for (int32_t length = 256; length <= 4096; length *= 2) {
+        int32_t *reference = malloc(sizeof(int32_t) * length);
+        int32_t *data = malloc(sizeof(int32_t) * length * count);
+        const int32_t **signals = malloc(sizeof(int32_t *) * count);
+        int32_t *delays = malloc(sizeof(int32_t) * count);
+        double t0, t_brute, t_fft;
+        Xcorr xc;
+
+        for (int32_t n = 0; n < length; n++) {
+            reference[n] = (n * 7919) % 4096 - 2048;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            for (int32_t n = 0; n < length; n++) {
+                data[i * length + n] = reference[(n + length - i) % length];
+            }
+            signals[i] = &data[i * length];
+        }
+
+        t0 = now_seconds();
+        for (int32_t i = 0; i < count; i++) {
+            delays[i] = brute_force_delay(reference, signals[i], length);
+        }
+        t_brute = now_seconds() - t0;
+
+        xcorr_init(&xc, length, XCORR_WEIGHT_NONE);
+        t0 = now_seconds();
+        xcorr_set_reference(&xc, reference);
+        xcorr_delays(&xc, signals, count, -1, delays);
+        t_fft = now_seconds() - t0;
+        xcorr_free(&xc);
+
+        printf("%-10d %14.3f %14.3f\n", length, t_brute * 1e3, t_fft * 1e3);
+        free(reference);
+        free(data);
+        free(signals);
+        free(delays);
+    }
+    printf("\n");
+}
+
+static void benchmark_spectral_peaks(void) {
+    const int32_t N = 1024, pad = 8, repeats = 200;
+    const double tone = 100.3;
+    int32_t *signal = malloc(sizeof(int32_t) * N);
+    Complex *frame = malloc(sizeof(Complex) * N);
+    Complex *padded = malloc(sizeof(Complex) * N * pad);
+    FftFourStep *plan = fft_four_step_create(N, NULL);
+    FftFourStep *padded_plan = fft_four_step_create(N * pad, NULL);
+    SpectralPeak peak;
+    double t0, t_pad, t_peaks, f_pad = 0, f_peaks = 0;
+
+    /* 0.5 cos(360 tone n / N degrees), 360 * 100.3 is a whole number */
+    for (int32_t n = 0; n < N; n++) {
+        int64_t angle = (((int64_t)(360 * tone + 0.5) * n) << CORDIC_MATH_FRACTION_BITS) / N;
+        int32_t sine, cosine;
+
+        cordic_sincos((int32_t)(angle % ((int64_t)360 << CORDIC_MATH_FRACTION_BITS)), &sine,
+                      &cosine);
+        signal[n] = cosine / 2;
+    }
+
+    printf("Frequency of a tone at bin %.2f, N = %d, us per frame\n", tone, N);
+    printf("%-26s %10s %12s\n", "method", "time", "frequency");
+
+    t0 = now_seconds();
+    for (int32_t r = 0; r < repeats; r++) {
+        int32_t best = 0;
+        int64_t best_power = -1;
+
+        for (int32_t n = 0; n < N * pad; n++) {
+            padded[n].real = n < N ? signal[n] : 0;
+            padded[n].imag = 0;
+        }
+        fft_four_step_execute(padded_plan, padded);
+        for (int32_t k = 1; k < N * pad / 2; k++) {
+            int64_t power = (int64_t)padded[k].real * padded[k].real +
+                            (int64_t)padded[k].imag * padded[k].imag;
+            if (power > best_power) {
+                best_power = power;
+                best = k;
+            }
+        }
+        f_pad = (double)best / pad;
+    }
+    t_pad = now_seconds() - t0;
+
+    t0 = now_seconds();
+    for (int32_t r = 0; r < repeats; r++) {
+        for (int32_t n = 0; n < N; n++) {
+            frame[n].real = signal[n];
+            frame[n].imag = 0;
+        }
+        fft_four_step_execute(plan, frame);
+        if (spectral_peaks_find(frame, N / 2, 0, 1, SPECTRAL_PEAKS_JACOBSEN, &peak) == 1) {
+            f_peaks = peak.frequency / 65536.0;
+        }
+    }
+    t_peaks = now_seconds() - t0;
+
+    printf("%-26s %10.1f %12.4f\n", "zero padded x8, max bin", t_pad * 1e6 / repeats, f_pad);
+    printf("%-26s %10.1f %12.4f\n", "spectral_peaks_find()", t_peaks * 1e6 / repeats, f_peaks);
+    printf("\n");
+    fft_four_step_destroy(plan);
+    fft_four_step_destroy(padded_plan);
+    free(signal);
+    free(frame);
+    free(padded);
+}
+
+int main(int argc, char *argv[]) {
+    int32_t out_of_core_log2 = argc > 1 ? atoi(argv[1]) : 24;
+
+    if (out_of_core_log2 < 22 || out_of_core_log2 > FFT_OUT_OF_CORE_MAX_LOG2) {
+        printf("usage: %s [log2 of the largest out of core FFT, 22 to %d]\n", argv[0],
+               FFT_OUT_OF_CORE_MAX_LOG2);
+        return 1;
+    }
+    benchmark_fft_variants();
+    benchmark_q15();
+    benchmark_inverse();
+    benchmark_four_step();
+    benchmark_fft2d();
+    benchmark_fast_convolution();
+    benchmark_spectrum();
+    benchmark_out_of_core(out_of_core_log2);
+    benchmark_xcorr();
+    benchmark_spectral_peaks();
+    return 0;
+}
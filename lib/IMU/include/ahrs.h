@@ -0,0 +1,46 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief AHRS_QUATERNION_BITS is the number of fraction bits of the
+ * quaternion. At a high sample rate the rotation per sample is far below
+ * the resolution of CORDIC_MATH_FRACTION_BITS.
+ */
+#define AHRS_QUATERNION_BITS 30
+
+/* One sample of the sensors, every value is fixedpoint according to
+ * CORDIC_MATH_FRACTION_BITS */
+typedef struct {
+    int32_t gx;  /* angular rate in degrees per second */
+    int32_t gy;
+    int32_t gz;
+    int32_t ax;  /* acceleration, any unit */
+    int32_t ay;
+    int32_t az;
+    int32_t mx;  /* magnetic field, any unit, all zero without a magnetometer */
+    int32_t my;
+    int32_t mz;
+} AhrsFrame;
+
+typedef struct {
+    int32_t roll;   /* degrees, fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t pitch;
+    int32_t yaw;
+} AhrsEuler;
+
+/* Mahony filter, the gyro is integrated and the error between the measured
+ * and the estimated direction of gravity and north steers it back */
+typedef struct {
+    int32_t q[4];         /* w, x, y, z, fixedpoint according to AHRS_QUATERNION_BITS */
+    int32_t kp;           /* proportional gain, fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t ki;           /* integral gain, fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t sample_rate;  /* Hz */
+    int64_t integral[3];  /* the gyro bias estimate, rad/s with 46 fraction bits */
+} Ahrs;
+
+int32_t ahrs_init(Ahrs *ahrs, int32_t sample_rate, int32_t kp, int32_t ki);
+void ahrs_update(Ahrs *ahrs, const AhrsFrame *frame);
+int32_t ahrs_update_batch(Ahrs *ahrs, const AhrsFrame frames[], int32_t count,
+                          AhrsEuler euler[]);
+void ahrs_euler(const Ahrs *ahrs, AhrsEuler *euler);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "stdint.h"
+#include "imu.h"
+
+/**
+ * @brief IMU_PIPELINE_MAX_BATCH is the largest number of samples the
+ * processing thread takes from the ring at a time.
+ */
+#define IMU_PIPELINE_MAX_BATCH 64
+/**
+ * @brief IMU_LATENCY_BUCKETS is the number of buckets of the latency
+ * histogram, bucket b counts latencies from 2^b to 2^(b + 1) - 1 ns.
+ */
+#define IMU_LATENCY_BUCKETS 32
+
+typedef struct {
+    uint64_t processed;           /* samples turned into an attitude */
+    uint64_t delivered;           /* attitudes taken with imu_pipeline_pop() */
+    uint64_t dropped_samples;     /* pushed while the sample ring was full */
+    uint64_t latency[IMU_LATENCY_BUCKETS];  /* from push to pop */
+} ImuPipelineStats;
+
+typedef struct ImuPipeline ImuPipeline;
+
+ImuPipeline *imu_pipeline_create(int32_t capacity, int32_t batch, int32_t q, int32_t r);
+int32_t imu_pipeline_push(ImuPipeline *pipeline, int32_t ax, int32_t ay, int32_t az);
+int32_t imu_pipeline_pop(ImuPipeline *pipeline, ImuAttitude attitudes[], int32_t max);
+void imu_pipeline_stats(const ImuPipeline *pipeline, ImuPipelineStats *stats);
+void imu_pipeline_destroy(ImuPipeline *pipeline);
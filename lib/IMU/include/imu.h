@@ -0,0 +1,19 @@
+#pragma once
+
+#include "stdint.h"
+
+typedef struct {
+    int32_t ax;         /* acceleration, fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t ay;
+    int32_t az;
+    int64_t timestamp;  /* nanoseconds, CLOCK_MONOTONIC */
+} ImuSample;
+
+typedef struct {
+    int32_t pitch;      /* filtered, degrees fixedpoint according to CORDIC_MATH_FRACTION_BITS */
+    int32_t roll;
+    int64_t timestamp;  /* of the sample the attitude was calculated from */
+} ImuAttitude;
+
+int64_t imu_now(void);
+void calculate_angles(int32_t ax, int32_t ay, int32_t az, int32_t *pitch, int32_t *roll);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "stdint.h"
+
+/* Lock-free ring buffer for one producer thread and one consumer thread */
+typedef struct SpscRing SpscRing;
+
+SpscRing *spsc_ring_create(int32_t capacity, int32_t element_size);
+int32_t spsc_ring_push(SpscRing *ring, const void *element);
+int32_t spsc_ring_pop(SpscRing *ring, void *elements, int32_t max);
+int32_t spsc_ring_count(const SpscRing *ring);
+void spsc_ring_destroy(SpscRing *ring);
@@ -0,0 +1,225 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "ahrs.h"
+#include "cordic-math.h"
+
+#define Q_BITS AHRS_QUATERNION_BITS
+#define Q_ONE ((int64_t)1 << Q_BITS)
+/* Angular rates inside the filter are rad/s with RATE_BITS fraction bits,
+ * enough range for 128 rad/s */
+#define RATE_BITS 24
+/* pi / 180 with Q_BITS fraction bits */
+#define DEGREES_TO_RADIANS ((int64_t)18740330)
+
+/**
+ * @brief The product of two numbers with Q_BITS fraction bits, rounded.
+ */
+static inline int32_t q_mul(int64_t a, int64_t b) {
+    return (int32_t)((a * b + (Q_ONE >> 1)) >> Q_BITS);
+}
+
+/**
+ * @brief Scales a vector to unit length with Q_BITS fraction bits. The
+ * length comes from two cordic vectorings, which neither overflow nor need
+ * the squares.
+ *
+ * @return 0 on success, -1 for the zero vector.
+ */
+static int32_t unit_vector(int32_t x, int32_t y, int32_t z, int32_t v[3]) {
+    int32_t xy, length;
+
+    cordic_vector(y, x, &xy, NULL);
+    cordic_vector(z, xy, &length, NULL);
+    if (length <= 0) {
+        return -1;
+    }
+    v[0] = (int32_t)(((int64_t)x << Q_BITS) / length);
+    v[1] = (int32_t)(((int64_t)y << Q_BITS) / length);
+    v[2] = (int32_t)(((int64_t)z << Q_BITS) / length);
+    return 0;
+}
+
+/**
+ * @brief e += a x b for vectors with Q_BITS fraction bits.
+ */
+static void add_cross(const int32_t a[3], const int32_t b[3], int32_t e[3]) {
+    e[0] += q_mul(a[1], b[2]) - q_mul(a[2], b[1]);
+    e[1] += q_mul(a[2], b[0]) - q_mul(a[0], b[2]);
+    e[2] += q_mul(a[0], b[1]) - q_mul(a[1], b[0]);
+}
+
+/**
+ * @brief The error between the measured magnetic field and the direction
+ * the quaternion expects it in. The field is rotated to the earth frame,
+ * its horizontal part is taken as north and rotated back.
+ */
+static void magnetometer_error(const int32_t q[4], const int32_t m[3], int32_t e[3]) {
+    int64_t q0q1 = q_mul(q[0], q[1]), q0q2 = q_mul(q[0], q[2]);
+    int64_t q0q3 = q_mul(q[0], q[3]), q1q1 = q_mul(q[1], q[1]), q1q2 = q_mul(q[1], q[2]);
+    int64_t q1q3 = q_mul(q[1], q[3]), q2q2 = q_mul(q[2], q[2]), q2q3 = q_mul(q[2], q[3]);
+    int64_t q3q3 = q_mul(q[3], q[3]), half = Q_ONE >> 1;
+    int32_t hx, hy, bx, bz, w[3];
+
+    hx = 2 * (q_mul(m[0], half - q2q2 - q3q3) + q_mul(m[1], q1q2 - q0q3) +
+              q_mul(m[2], q1q3 + q0q2));
+    hy = 2 * (q_mul(m[0], q1q2 + q0q3) + q_mul(m[1], half - q1q1 - q3q3) +
+              q_mul(m[2], q2q3 - q0q1));
+    bz = 2 * (q_mul(m[0], q1q3 - q0q2) + q_mul(m[1], q2q3 + q0q1) +
+              q_mul(m[2], half - q1q1 - q2q2));
+    cordic_vector(hy, hx, &bx, NULL);
+
+    w[0] = 2 * (q_mul(bx, half - q2q2 - q3q3) + q_mul(bz, q1q3 - q0q2));
+    w[1] = 2 * (q_mul(bx, q1q2 - q0q3) + q_mul(bz, q0q1 + q2q3));
+    w[2] = 2 * (q_mul(bx, q0q2 + q1q3) + q_mul(bz, half - q1q1 - q2q2));
+    add_cross(m, w, e);
+}
+
+/**
+ * @brief Rotates q by the angle vector h (half the rotation angle, radians
+ * with Q_BITS fraction bits), q = q * [cos|h|, sin|h| h / |h|]. The angle
+ * per sample is small, so the series to the fourth order is exact in Q30.
+ * cordic_sincos() gives 16 fraction bits, which is not enough to resolve a
+ * rotation of a few millidegrees.
+ */
+static void rotate(int32_t q[4], const int32_t h[3]) {
+    int64_t h2 = (int64_t)q_mul(h[0], h[0]) + q_mul(h[1], h[1]) + q_mul(h[2], h[2]);
+    int64_t h4 = q_mul(h2, h2);
+    int64_t c = Q_ONE - h2 / 2 + h4 / 24;     /* cos|h| */
+    int64_t s = Q_ONE - h2 / 6 + h4 / 120;    /* sin|h| / |h| */
+    int64_t r[4] = {c, q_mul(s, h[0]), q_mul(s, h[1]), q_mul(s, h[2])};
+    int64_t p[4] = {q[0], q[1], q[2], q[3]};
+    int64_t half = Q_ONE >> 1;
+
+    q[0] = (int32_t)((p[0] * r[0] - p[1] * r[1] - p[2] * r[2] - p[3] * r[3] + half) >> Q_BITS);
+    q[1] = (int32_t)((p[0] * r[1] + p[1] * r[0] + p[2] * r[3] - p[3] * r[2] + half) >> Q_BITS);
+    q[2] = (int32_t)((p[0] * r[2] - p[1] * r[3] + p[2] * r[0] + p[3] * r[1] + half) >> Q_BITS);
+    q[3] = (int32_t)((p[0] * r[3] + p[1] * r[2] - p[2] * r[1] + p[3] * r[0] + half) >> Q_BITS);
+}
+
+/**
+ * @brief Scales q to unit length with two Newton steps of the inverse
+ * square root, y = y * (3 - n * y^2) / 2 from y = 1. The norm is close to
+ * 1 after every update, so no square root or division is needed.
+ */
+static void normalize(int32_t q[4]) {
+    int64_t n = (int64_t)q_mul(q[0], q[0]) + q_mul(q[1], q[1]) + q_mul(q[2], q[2]) +
+                q_mul(q[3], q[3]);
+    int64_t y = Q_ONE;
+
+    for (int32_t i = 0; i < 2; i++) {
+        y = q_mul(y, (3 * Q_ONE - q_mul(n, q_mul(y, y))) / 2);
+    }
+    for (int32_t i = 0; i < 4; i++) {
+        q[i] = q_mul(q[i], y);
+    }
+}
+
+/**
+ * @brief Initializes the filter to the level attitude.
+ *
+ * @param ahrs the filter.
+ * @param sample_rate the rate of ahrs_update() calls in Hz.
+ * @param kp the proportional gain, fixedpoint according to
+ * CORDIC_MATH_FRACTION_BITS, how fast the accelerometer and magnetometer
+ * pull the attitude, 0.5 to 2 is common.
+ * @param ki the integral gain, fixedpoint according to
+ * CORDIC_MATH_FRACTION_BITS, how fast the gyro bias is learned, 0 disables it.
+ *
+ * @return 0 on success, -1 if the sample rate is invalid.
+ */
+int32_t ahrs_init(Ahrs *ahrs, int32_t sample_rate, int32_t kp, int32_t ki) {
+    memset(ahrs, 0, sizeof(Ahrs));
+    if (sample_rate < 1) {
+        return -1;
+    }
+    ahrs->q[0] = (int32_t)(Q_ONE - 1);
+    ahrs->kp = kp;
+    ahrs->ki = ki;
+    ahrs->sample_rate = sample_rate;
+    return 0;
+}
+
+/**
+ * @brief Updates the attitude with one sample of the sensors. Without an
+ * accelerometer reading the gyro is integrated alone, without a
+ * magnetometer reading the yaw drifts with the gyro.
+ */
+void ahrs_update(Ahrs *ahrs, const AhrsFrame *frame) {
+    int32_t *q = ahrs->q;
+    int32_t a[3], m[3], e[3] = {0, 0, 0}, h[3];
+    int32_t gyro[3] = {frame->gx, frame->gy, frame->gz};
+
+    if (unit_vector(frame->ax, frame->ay, frame->az, a) == 0) {
+        /* The direction of gravity the quaternion expects */
+        int32_t v[3];
+        v[0] = 2 * (q_mul(q[1], q[3]) - q_mul(q[0], q[2]));
+        v[1] = 2 * (q_mul(q[0], q[1]) + q_mul(q[2], q[3]));
+        v[2] = q_mul(q[0], q[0]) - q_mul(q[1], q[1]) - q_mul(q[2], q[2]) + q_mul(q[3], q[3]);
+        add_cross(a, v, e);
+
+        if (unit_vector(frame->mx, frame->my, frame->mz, m) == 0) {
+            magnetometer_error(q, m, e);
+        }
+    }
+
+    for (int32_t i = 0; i < 3; i++) {
+        /* degrees/s with CORDIC_MATH_FRACTION_BITS to rad/s with RATE_BITS */
+        int64_t rate = (gyro[i] * DEGREES_TO_RADIANS) >>
+                       (Q_BITS + CORDIC_MATH_FRACTION_BITS - RATE_BITS);
+        int64_t correction = (int64_t)ahrs->kp * e[i];
+
+        ahrs->integral[i] += (int64_t)ahrs->ki * e[i] / ahrs->sample_rate;
+        rate += (correction + ahrs->integral[i]) >>
+                (Q_BITS + CORDIC_MATH_FRACTION_BITS - RATE_BITS);
+        /* Half the angle turned during this sample */
+        h[i] = (int32_t)((rate << (Q_BITS - RATE_BITS)) / (2 * ahrs->sample_rate));
+    }
+    rotate(q, h);
+    normalize(q);
+}
+
+/**
+ * @brief Updates the attitude with a batch of samples.
+ *
+ * @param ahrs the filter.
+ * @param frames the samples in the order they were measured.
+ * @param count the number of samples.
+ * @param euler the attitude after every sample, NULL if only the final
+ * attitude is needed, the Euler angles cost three cordic calls.
+ *
+ * @return The number of samples processed.
+ */
+int32_t ahrs_update_batch(Ahrs *ahrs, const AhrsFrame frames[], int32_t count,
+                          AhrsEuler euler[]) {
+    for (int32_t i = 0; i < count; i++) {
+        ahrs_update(ahrs, &frames[i]);
+        if (euler != NULL) {
+            ahrs_euler(ahrs, &euler[i]);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief The attitude as roll, pitch and yaw in degrees, rotated in the
+ * order yaw, pitch, roll. atan2 is cordic_vector(). The pitch is the asin
+ * of 2 (q0 q2 - q1 q3), taken as the angle of that sine and the cosine of
+ * the pitch, which is the length of the vector the roll is vectored from.
+ * cordic_asin() loses several degrees on the way to +-90.
+ */
+void ahrs_euler(const Ahrs *ahrs, AhrsEuler *euler) {
+    const int32_t *q = ahrs->q;
+    int32_t shift = Q_BITS - CORDIC_MATH_FRACTION_BITS;
+    int64_t one = Q_ONE;
+    int32_t cos_pitch;
+
+    cordic_vector((2 * (q_mul(q[0], q[1]) + q_mul(q[2], q[3]))) >> shift,
+                  (int32_t)((one - 2 * ((int64_t)q_mul(q[1], q[1]) + q_mul(q[2], q[2]))) >> shift),
+                  &cos_pitch, &euler->roll);
+    cordic_vector((2 * (q_mul(q[0], q[2]) - q_mul(q[1], q[3]))) >> shift, cos_pitch,
+                  NULL, &euler->pitch);
+    cordic_vector((2 * (q_mul(q[0], q[3]) + q_mul(q[1], q[2]))) >> shift,
+                  (int32_t)((one - 2 * ((int64_t)q_mul(q[2], q[2]) + q_mul(q[3], q[3]))) >> shift),
+                  NULL, &euler->yaw);
+}
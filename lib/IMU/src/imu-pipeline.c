@@ -0,0 +1,246 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "imu-pipeline.h"
+#include "spsc-ring.h"
+#include "kalman.h"
+
+/*
+ * The acquisition thread pushes raw samples into one ring, a processing
+ * thread takes them in batches, runs calculate_angles() and the pitch and
+ * roll filters and pushes the attitude into a second ring. The processing
+ * thread takes no more samples than the attitude ring has room for, so a
+ * slow consumer fills the sample ring and imu_pipeline_push() fails instead
+ * of attitudes getting lost. Neither side takes a lock or allocates memory
+ * after imu_pipeline_create().
+ */
+struct ImuPipeline {
+    SpscRing *samples;
+    SpscRing *attitudes;
+    int32_t capacity;
+    int32_t batch;
+    KalmanFilter pitch;
+    KalmanFilter roll;
+    ImuSample in[IMU_PIPELINE_MAX_BATCH];
+    int32_t angles[IMU_PIPELINE_MAX_BATCH][2];
+    pthread_t thread;
+    _Atomic int32_t stop;
+    _Atomic uint64_t processed;
+    _Atomic uint64_t delivered;
+    _Atomic uint64_t dropped_samples;
+    _Atomic uint64_t latency[IMU_LATENCY_BUCKETS];
+};
+
+/**
+ * @brief Counter with a single writer, a load and a store are enough.
+ */
+static void count(_Atomic uint64_t *counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+static int32_t latency_bucket(int64_t nanoseconds) {
+    int32_t bucket = 0;
+
+    while (bucket < IMU_LATENCY_BUCKETS - 1 && (nanoseconds >> (bucket + 1)) > 0) {
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Processes one batch. The angles of the whole batch are calculated
+ * first, the filters run over them afterwards since every update depends
+ * on the one before. The attitude ring has room for the whole batch.
+ */
+static void process_batch(ImuPipeline *pipeline, int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        calculate_angles(pipeline->in[i].ax, pipeline->in[i].ay, pipeline->in[i].az,
+                         &pipeline->angles[i][0], &pipeline->angles[i][1]);
+    }
+    for (int32_t i = 0; i < n; i++) {
+        ImuAttitude attitude;
+
+        kalman_update(&pipeline->pitch, pipeline->angles[i][0]);
+        kalman_update(&pipeline->roll, pipeline->angles[i][1]);
+        attitude.pitch = pipeline->pitch.x;
+        attitude.roll = pipeline->roll.x;
+        attitude.timestamp = pipeline->in[i].timestamp;
+        spsc_ring_push(pipeline->attitudes, &attitude);
+    }
+    count(&pipeline->processed, n);
+}
+
+/**
+ * @brief Takes the next batch of samples, at most as many as the attitude
+ * ring has room for. The count of the ring may be stale on the consumer
+ * side, which only makes the room look smaller.
+ *
+ * @return The number of samples taken, 0 if there are none or there is no
+ * room for their attitudes.
+ */
+static int32_t take_batch(ImuPipeline *pipeline) {
+    int32_t room = pipeline->capacity - spsc_ring_count(pipeline->attitudes);
+
+    if (room <= 0) {
+        return 0;
+    }
+    return spsc_ring_pop(pipeline->samples, pipeline->in,
+                         room < pipeline->batch ? room : pipeline->batch);
+}
+
+static void *processing_main(void *arg) {
+    ImuPipeline *pipeline = arg;
+
+    for (;;) {
+        int32_t n = take_batch(pipeline);
+
+        if (n > 0) {
+            process_batch(pipeline, n);
+        } else if (atomic_load_explicit(&pipeline->stop, memory_order_acquire)) {
+            /* Samples pushed right before the stop are visible now, those
+             * without room in the attitude ring are discarded */
+            while ((n = take_batch(pipeline)) > 0) {
+                process_batch(pipeline, n);
+            }
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Creates the rings and starts the processing thread.
+ *
+ * @param capacity the number of elements of each ring, a number 2^k.
+ * @param batch the largest number of samples processed at a time, at most
+ * IMU_PIPELINE_MAX_BATCH. A small batch gives a low latency, a large one
+ * a high throughput.
+ * @param q the process noise covariance of the pitch and roll filters,
+ * fixedpoint according to KALMAN_FRACTION_BITS.
+ * @param r the measurement noise covariance, fixedpoint according to
+ * KALMAN_FRACTION_BITS.
+ *
+ * @return Pointer to the pipeline, NULL if it could not be created.
+ */
+ImuPipeline *imu_pipeline_create(int32_t capacity, int32_t batch, int32_t q, int32_t r) {
+    ImuPipeline *pipeline;
+
+    if (batch < 1 || batch > IMU_PIPELINE_MAX_BATCH) {
+        return NULL;
+    }
+    pipeline = calloc(1, sizeof(ImuPipeline));
+    if (pipeline == NULL) {
+        return NULL;
+    }
+    pipeline->samples = spsc_ring_create(capacity, sizeof(ImuSample));
+    pipeline->attitudes = spsc_ring_create(capacity, sizeof(ImuAttitude));
+    if (pipeline->samples == NULL || pipeline->attitudes == NULL) {
+        spsc_ring_destroy(pipeline->samples);
+        spsc_ring_destroy(pipeline->attitudes);
+        free(pipeline);
+        return NULL;
+    }
+    pipeline->capacity = capacity;
+    pipeline->batch = batch;
+    kalman_init(&pipeline->pitch, q, r, 0);
+    kalman_init(&pipeline->roll, q, r, 0);
+    atomic_init(&pipeline->stop, 0);
+    atomic_init(&pipeline->processed, 0);
+    atomic_init(&pipeline->delivered, 0);
+    atomic_init(&pipeline->dropped_samples, 0);
+    for (int32_t b = 0; b < IMU_LATENCY_BUCKETS; b++) {
+        atomic_init(&pipeline->latency[b], 0);
+    }
+    if (pthread_create(&pipeline->thread, NULL, processing_main, pipeline) != 0) {
+        spsc_ring_destroy(pipeline->samples);
+        spsc_ring_destroy(pipeline->attitudes);
+        free(pipeline);
+        return NULL;
+    }
+    return pipeline;
+}
+
+/**
+ * @brief Hands a raw sample to the pipeline, called from the acquisition
+ * thread only. The sample is time stamped here.
+ *
+ * @param pipeline the pipeline.
+ * @param ax fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param ay fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param az fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ *
+ * @return 0 on success, -1 if the sample ring is full and the sample was
+ * dropped. The ring fills up when the consumer does not keep up with
+ * imu_pipeline_pop().
+ */
+int32_t imu_pipeline_push(ImuPipeline *pipeline, int32_t ax, int32_t ay, int32_t az) {
+    ImuSample sample;
+
+    sample.ax = ax;
+    sample.ay = ay;
+    sample.az = az;
+    sample.timestamp = imu_now();
+    if (spsc_ring_push(pipeline->samples, &sample) != 0) {
+        count(&pipeline->dropped_samples, 1);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Takes filtered attitudes, called from one consumer thread only.
+ * The latency of every attitude is counted here, when it is delivered.
+ *
+ * @return The number of attitudes taken, 0 if none are ready.
+ */
+int32_t imu_pipeline_pop(ImuPipeline *pipeline, ImuAttitude attitudes[], int32_t max) {
+    int32_t n = spsc_ring_pop(pipeline->attitudes, attitudes, max);
+    int64_t now;
+
+    if (n == 0) {
+        return 0;
+    }
+    now = imu_now();
+    for (int32_t i = 0; i < n; i++) {
+        count(&pipeline->latency[latency_bucket(now - attitudes[i].timestamp)], 1);
+    }
+    count(&pipeline->delivered, n);
+    return n;
+}
+
+/**
+ * @brief Copies the counters and the latency histogram, the latency is the
+ * time from imu_pipeline_push() until imu_pipeline_pop() returns the
+ * attitude.
+ */
+void imu_pipeline_stats(const ImuPipeline *pipeline, ImuPipelineStats *stats) {
+    stats->processed = atomic_load_explicit(&pipeline->processed, memory_order_relaxed);
+    stats->delivered = atomic_load_explicit(&pipeline->delivered, memory_order_relaxed);
+    stats->dropped_samples =
+        atomic_load_explicit(&pipeline->dropped_samples, memory_order_relaxed);
+    for (int32_t b = 0; b < IMU_LATENCY_BUCKETS; b++) {
+        stats->latency[b] = atomic_load_explicit(&pipeline->latency[b], memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Processes the samples still in the ring as far as the attitude
+ * ring has room, stops the processing thread and frees the pipeline.
+ *
+ * @param pipeline the pipeline, NULL is allowed.
+ */
+void imu_pipeline_destroy(ImuPipeline *pipeline) {
+    if (pipeline == NULL) {
+        return;
+    }
+    atomic_store_explicit(&pipeline->stop, 1, memory_order_release);
+    pthread_join(pipeline->thread, NULL);
+    spsc_ring_destroy(pipeline->samples);
+    spsc_ring_destroy(pipeline->attitudes);
+    free(pipeline);
+}
@@ -0,0 +1,29 @@
+#include <time.h>
+
+#include "imu.h"
+#include "cordic-math.h"
+
+/**
+ * @brief The time stamp of the samples, CLOCK_MONOTONIC in nanoseconds.
+ */
+int64_t imu_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Calculates pitch and roll from accelerometer data using CORDIC.
+ *
+ * @param ax fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param ay fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param az fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param pitch degrees, fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param roll degrees, fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ */
+void calculate_angles(int32_t ax, int32_t ay, int32_t az, int32_t *pitch, int32_t *roll) {
+    int32_t hyp = cordic_hypotenuse(ay, az);
+    *pitch = cordic_atan(-ax, hyp);
+    *roll = cordic_atan(ay, az);
+}
@@ -0,0 +1,131 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc-ring.h"
+
+/*
+ * The producer only writes head and the consumer only writes tail, both
+ * count up without wrapping at the capacity, so head - tail is the fill
+ * level. Each side keeps a copy of the other side's index on its own cache
+ * line and only reads the shared index again when the copy says the ring
+ * is full or empty.
+ */
+struct SpscRing {
+    _Atomic uint32_t head;   /* next element the producer writes */
+    uint32_t cached_tail;    /* the producer's copy of tail */
+    char pad0[64 - 2 * sizeof(uint32_t)];
+    _Atomic uint32_t tail;   /* next element the consumer reads */
+    uint32_t cached_head;    /* the consumer's copy of head */
+    char pad1[64 - 2 * sizeof(uint32_t)];
+    uint32_t mask;
+    int32_t element_size;
+    unsigned char *buffer;
+};
+
+/**
+ * @brief Creates a ring buffer, all memory is allocated here.
+ *
+ * @param capacity the number of elements, a number 2^k.
+ * @param element_size the size of an element in bytes.
+ *
+ * @return Pointer to the ring, NULL if the arguments are invalid or the
+ * memory could not be allocated.
+ */
+SpscRing *spsc_ring_create(int32_t capacity, int32_t element_size) {
+    SpscRing *ring;
+
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0 || element_size < 1) {
+        return NULL;
+    }
+    ring = aligned_alloc(64, sizeof(SpscRing));
+    if (ring == NULL) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(SpscRing));
+    ring->buffer = malloc((size_t)capacity * element_size);
+    if (ring->buffer == NULL) {
+        free(ring);
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->mask = (uint32_t)capacity - 1;
+    ring->element_size = element_size;
+    return ring;
+}
+
+/**
+ * @brief Adds an element, called from the producer thread only.
+ *
+ * @return 0 on success, -1 if the ring is full.
+ */
+int32_t spsc_ring_push(SpscRing *ring, const void *element) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head - ring->cached_tail > ring->mask) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail > ring->mask) {
+            return -1;
+        }
+    }
+    memcpy(&ring->buffer[(size_t)(head & ring->mask) * ring->element_size], element,
+           ring->element_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * @brief Takes up to max elements, called from the consumer thread only.
+ * The elements are released in one go so a batch costs one atomic store.
+ *
+ * @param ring the ring.
+ * @param elements room for max elements.
+ * @param max the largest number of elements to take.
+ *
+ * @return The number of elements taken, 0 if the ring is empty.
+ */
+int32_t spsc_ring_pop(SpscRing *ring, void *elements, int32_t max) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t available = ring->cached_head - tail;
+    int32_t count;
+
+    if (available < (uint32_t)max) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        available = ring->cached_head - tail;
+    }
+    count = available < (uint32_t)max ? (int32_t)available : max;
+    for (int32_t i = 0; i < count; i++) {
+        memcpy((unsigned char *)elements + (size_t)i * ring->element_size,
+               &ring->buffer[(size_t)((tail + i) & ring->mask) * ring->element_size],
+               ring->element_size);
+    }
+    if (count > 0) {
+        atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    }
+    return count;
+}
+
+/**
+ * @brief The number of elements in the ring, only a snapshot while the
+ * other thread is running.
+ */
+int32_t spsc_ring_count(const SpscRing *ring) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    return (int32_t)(head - tail);
+}
+
+/**
+ * @brief Frees the ring.
+ *
+ * @param ring the ring, NULL is allowed.
+ */
+void spsc_ring_destroy(SpscRing *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    free(ring->buffer);
+    free(ring);
+}
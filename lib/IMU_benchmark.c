@@ -0,0 +1,318 @@
+// Benchmarks for the IMU library.
+//
+// Build from the lib folder:
+//   gcc -O2 -IcordicMath/include -IKalman/include -IIMU/include -IDecimator/include IMU_benchmark.c cordicMath/src/*.c Kalman/src/*.c IMU/src/*.c Decimator/src/*.c -o imu_benchmark -lpthread -lm
+//
+// The acquisition thread pushes samples as fast as the pipeline takes
+// them, the latency is the time from imu_pipeline_push() until
+// imu_pipeline_pop() returns the attitude. The throughput counts delivered
+// attitudes only. The AHRS is compared with the same Mahony filter
+// in float. The decimation benchmark runs the angles and the Kalman filters
+// on 8 kHz samples directly and after decimating to 500 Hz.
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ahrs.h"
+#include "decimator.h"
+#include "imu.h"
+#include "imu-pipeline.h"
+#include "kalman.h"
+
+#define SAMPLES 2000000
+
+typedef struct {
+    ImuPipeline *pipeline;
+    int64_t full;
+} Producer;
+
+static void *producer_main(void *arg) {
+    Producer *producer = arg;
+
+    for (int32_t i = 0; i < SAMPLES; i++) {
+        int32_t ax = (int32_t)(((int64_t)i * 7919) % 4096 - 2048) << 3;
+        int32_t ay = (int32_t)(((int64_t)i * 104729) % 4096 - 2048) << 3;
+        int32_t az = 1 << 16;
+
+        while (imu_pipeline_push(producer->pipeline, ax, ay, az) != 0) {
+            producer->full++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// The latency below which the given fraction of the samples lies, as the
+// upper edge of the histogram bucket
+static double percentile(const ImuPipelineStats *stats, double fraction) {
+    uint64_t total = 0, seen = 0;
+
+    for (int32_t b = 0; b < IMU_LATENCY_BUCKETS; b++) {
+        total += stats->latency[b];
+    }
+    for (int32_t b = 0; b < IMU_LATENCY_BUCKETS; b++) {
+        seen += stats->latency[b];
+        if (seen >= fraction * total) {
+            return (double)((int64_t)1 << (b + 1)) * 1e-3;
+        }
+    }
+    return 0;
+}
+
+static void benchmark_pipeline(void) {
+    int32_t batches[] = {1, 8, 64};
+
+    printf("IMU pipeline, %d samples\n", SAMPLES);
+    printf("%-8s %12s %10s %10s %10s %12s\n", "batch", "Msamples/s", "p50 us", "p99 us",
+           "p99.9 us", "ring full");
+    for (int32_t t = 0; t < 3; t++) {
+        ImuPipeline *pipeline = imu_pipeline_create(1024, batches[t], 1 << 10, 1 << 14);
+        Producer producer = {pipeline, 0};
+        ImuAttitude attitudes[IMU_PIPELINE_MAX_BATCH];
+        ImuPipelineStats stats;
+        pthread_t thread;
+        int64_t t0, t1, delivered = 0;
+
+        t0 = imu_now();
+        pthread_create(&thread, NULL, producer_main, &producer);
+        /* A slow consumer holds the producer back instead of losing
+         * attitudes, the loop ends when every sample is processed and the
+         * ring is empty */
+        for (;;) {
+            int32_t n = imu_pipeline_pop(pipeline, attitudes, IMU_PIPELINE_MAX_BATCH);
+            delivered += n;
+            if (n == 0) {
+                imu_pipeline_stats(pipeline, &stats);
+                if (stats.processed == SAMPLES) {
+                    n = imu_pipeline_pop(pipeline, attitudes, IMU_PIPELINE_MAX_BATCH);
+                    delivered += n;
+                    if (n == 0) {
+                        break;
+                    }
+                }
+                sched_yield();
+            }
+        }
+        t1 = imu_now();
+        pthread_join(thread, NULL);
+        imu_pipeline_stats(pipeline, &stats);
+        printf("%-8d %12.2f %10.1f %10.1f %10.1f %12lld\n", batches[t],
+               delivered / ((t1 - t0) * 1e-9) * 1e-6, percentile(&stats, 0.5),
+               percentile(&stats, 0.99), percentile(&stats, 0.999), (long long)producer.full);
+        imu_pipeline_destroy(pipeline);
+        if (delivered != SAMPLES) {
+            printf("only %lld of %d attitudes delivered\n", (long long)delivered, SAMPLES);
+            exit(1);
+        }
+    }
+    printf("\n");
+}
+
+#define AHRS_FRAMES 4096
+#define AHRS_ROUNDS 64
+#define DEGREES (180.0f / 3.14159265f)
+
+typedef struct {
+    float q[4];
+    float kp;
+    float ki;
+    float dt;
+    float integral[3];
+} AhrsFloat;
+
+// The float reference, the same Mahony update as ahrs_update() with the
+// accelerometer only
+static void ahrs_float_update(AhrsFloat *f, const AhrsFrame *frame) {
+    float *q = f->q;
+    float g[3] = {frame->gx / 65536.0f / DEGREES, frame->gy / 65536.0f / DEGREES,
+                  frame->gz / 65536.0f / DEGREES};
+    float ax = frame->ax, ay = frame->ay, az = frame->az;
+    float n = sqrtf(ax * ax + ay * ay + az * az);
+    float e[3], w, x, y, z;
+
+    ax /= n;
+    ay /= n;
+    az /= n;
+    e[0] = ay * (q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]) -
+           az * 2 * (q[0] * q[1] + q[2] * q[3]);
+    e[1] = az * 2 * (q[1] * q[3] - q[0] * q[2]) -
+           ax * (q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]);
+    e[2] = ax * 2 * (q[0] * q[1] + q[2] * q[3]) - ay * 2 * (q[1] * q[3] - q[0] * q[2]);
+    for (int32_t i = 0; i < 3; i++) {
+        f->integral[i] += f->ki * e[i] * f->dt;
+        g[i] = (g[i] + f->kp * e[i] + f->integral[i]) * 0.5f * f->dt;
+    }
+    w = q[0];
+    x = q[1];
+    y = q[2];
+    z = q[3];
+    q[0] += -x * g[0] - y * g[1] - z * g[2];
+    q[1] += w * g[0] + y * g[2] - z * g[1];
+    q[2] += w * g[1] - x * g[2] + z * g[0];
+    q[3] += w * g[2] + x * g[1] - y * g[0];
+    n = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (int32_t i = 0; i < 4; i++) {
+        q[i] *= n;
+    }
+}
+
+static void benchmark_ahrs(void) {
+    static AhrsFrame frames[AHRS_FRAMES];
+    static AhrsEuler euler[AHRS_FRAMES];
+    AhrsFloat reference = {{1, 0, 0, 0}, 1.0f, 0.1f, 1.0f / 1000, {0, 0, 0}};
+    float roll, pitch, yaw, error = 0;
+    Ahrs ahrs;
+    int64_t t0, t1;
+
+    /* A slow tumble with vibration on the accelerometer, 1 kHz */
+    for (int32_t i = 0; i < AHRS_FRAMES; i++) {
+        float t = i / 1000.0f;
+        AhrsFrame frame = {(int32_t)(65536 * (40 * sinf(1.3f * t) + 0.5f)),
+                           (int32_t)(65536 * 30 * cosf(0.7f * t)),
+                           (int32_t)(65536 * (20 * sinf(0.4f * t) - 0.3f)),
+                           (int32_t)(65536 * 0.1f * sinf(30 * t)),
+                           (int32_t)(65536 * 0.2f * cosf(20 * t)),
+                           65536, 0, 0, 0};
+        frames[i] = frame;
+    }
+
+    ahrs_init(&ahrs, 1000, 1 << 16, 6554);
+    t0 = imu_now();
+    for (int32_t r = 0; r < AHRS_ROUNDS; r++) {
+        ahrs_update_batch(&ahrs, frames, AHRS_FRAMES, NULL);
+    }
+    t1 = imu_now();
+    printf("AHRS, %d frames\n", AHRS_FRAMES * AHRS_ROUNDS);
+    printf("%-28s %12.2f Mupdates/s\n", "fixed point",
+           AHRS_FRAMES * AHRS_ROUNDS / ((t1 - t0) * 1e-9) * 1e-6);
+
+    ahrs_init(&ahrs, 1000, 1 << 16, 6554);
+    t0 = imu_now();
+    for (int32_t r = 0; r < AHRS_ROUNDS; r++) {
+        ahrs_update_batch(&ahrs, frames, AHRS_FRAMES, euler);
+    }
+    t1 = imu_now();
+    printf("%-28s %12.2f Mupdates/s\n", "fixed point with Euler",
+           AHRS_FRAMES * AHRS_ROUNDS / ((t1 - t0) * 1e-9) * 1e-6);
+
+    t0 = imu_now();
+    for (int32_t r = 0; r < AHRS_ROUNDS; r++) {
+        for (int32_t i = 0; i < AHRS_FRAMES; i++) {
+            ahrs_float_update(&reference, &frames[i]);
+        }
+    }
+    t1 = imu_now();
+    printf("%-28s %12.2f Mupdates/s\n", "float",
+           AHRS_FRAMES * AHRS_ROUNDS / ((t1 - t0) * 1e-9) * 1e-6);
+
+    /* Run both from the start once more and compare the angles */
+    ahrs_init(&ahrs, 1000, 1 << 16, 6554);
+    reference = (AhrsFloat){{1, 0, 0, 0}, 1.0f, 0.1f, 1.0f / 1000, {0, 0, 0}};
+    ahrs_update_batch(&ahrs, frames, AHRS_FRAMES, euler);
+    for (int32_t i = 0; i < AHRS_FRAMES; i++) {
+        float *q = reference.q;
+
+        ahrs_float_update(&reference, &frames[i]);
+        roll = atan2f(2 * (q[0] * q[1] + q[2] * q[3]), 1 - 2 * (q[1] * q[1] + q[2] * q[2]));
+        pitch = asinf(2 * (q[0] * q[2] - q[1] * q[3]));
+        yaw = atan2f(2 * (q[0] * q[3] + q[1] * q[2]), 1 - 2 * (q[2] * q[2] + q[3] * q[3]));
+        error = fmaxf(error, fabsf(euler[i].roll / 65536.0f - roll * DEGREES));
+        error = fmaxf(error, fabsf(euler[i].pitch / 65536.0f - pitch * DEGREES));
+        error = fmaxf(error, fabsf(euler[i].yaw / 65536.0f - yaw * DEGREES));
+    }
+    printf("largest difference to float: %.4f degrees\n\n", error);
+}
+
+#define INPUT_RATE 8000
+#define DECIMATION_FRAMES (INPUT_RATE * 60)
+#define DECIMATION_BLOCK 256
+
+typedef struct {
+    int32_t cic_ratio;   /* 1 runs without a decimator */
+    int32_t cic_stages;
+    int32_t fir_ratio;   /* 1 runs without the FIR */
+    int32_t fir_taps;
+} DecimationSetup;
+
+// The angles and the Kalman filters of every frame that leaves the
+// decimators, returns the time per input frame in ns
+static double decimation_run(const int32_t frames[], const DecimationSetup *setup) {
+    static int32_t decimated[DECIMATION_BLOCK * 3];
+    int32_t taps[64];
+    CicDecimator cic;
+    FirDecimator fir;
+    KalmanFilter pitch_filter, roll_filter;
+    int64_t t0, t1;
+
+    cic_decimator_init(&cic, setup->cic_ratio, setup->cic_stages, 3);
+    fir_decimator_design(taps, setup->fir_taps, setup->fir_ratio);
+    fir_decimator_init(&fir, taps, setup->fir_taps, setup->fir_ratio, 3);
+    kalman_init(&pitch_filter, 1 << 10, 1 << 14, 0);
+    kalman_init(&roll_filter, 1 << 10, 1 << 14, 0);
+
+    t0 = imu_now();
+    for (int32_t f = 0; f < DECIMATION_FRAMES; f += DECIMATION_BLOCK) {
+        const int32_t *block = &frames[f * 3];
+        int32_t count = DECIMATION_BLOCK;
+
+        if (setup->cic_ratio > 1) {
+            count = cic_decimator_process(&cic, block, decimated, count);
+            block = decimated;
+        }
+        if (setup->fir_ratio > 1) {
+            count = fir_decimator_process(&fir, block, decimated, count);
+            block = decimated;
+        }
+        for (int32_t i = 0; i < count; i++) {
+            int32_t pitch, roll;
+            calculate_angles(block[3 * i], block[3 * i + 1], block[3 * i + 2], &pitch, &roll);
+            kalman_update(&pitch_filter, pitch);
+            kalman_update(&roll_filter, roll);
+        }
+    }
+    t1 = imu_now();
+
+    cic_decimator_free(&cic);
+    fir_decimator_free(&fir);
+    return (double)(t1 - t0) / DECIMATION_FRAMES;
+}
+
+static void benchmark_decimation(void) {
+    const DecimationSetup setups[] = {{1, 1, 1, 3}, {16, 4, 1, 3}, {8, 3, 2, 32}, {4, 3, 4, 48}};
+    const char *names[] = {"none, 8000 Hz", "CIC 16, 500 Hz", "CIC 8 + FIR 2, 500 Hz",
+                           "CIC 4 + FIR 4, 500 Hz"};
+    int32_t *frames = malloc(sizeof(int32_t) * DECIMATION_FRAMES * 3);
+    double full = 0;
+
+    if (frames == NULL) {
+        return;
+    }
+    /* A slow tilt with vibration far above 250 Hz */
+    for (int32_t i = 0; i < DECIMATION_FRAMES; i++) {
+        int32_t noise = (int32_t)(((int64_t)i * 7919) % 4096 - 2048) << 3;
+        frames[3 * i] = (int32_t)(((int64_t)(i % INPUT_RATE) << 14) / INPUT_RATE) + noise;
+        frames[3 * i + 1] = (1 << 13) - noise;
+        frames[3 * i + 2] = (1 << 16) + noise / 2;
+    }
+
+    printf("Decimation, %d frames of 3 channels at %d Hz\n", DECIMATION_FRAMES, INPUT_RATE);
+    printf("%-24s %14s %10s\n", "front end", "ns per frame", "CPU saved");
+    for (int32_t s = 0; s < 4; s++) {
+        double t = decimation_run(frames, &setups[s]);
+        if (s == 0) {
+            full = t;
+        }
+        printf("%-24s %14.1f %9.1f%%\n", names[s], t, 100.0 * (1.0 - t / full));
+    }
+    printf("\n");
+    free(frames);
+}
+
+int main(void) {
+    benchmark_pipeline();
+    benchmark_ahrs();
+    benchmark_decimation();
+    return 0;
+}
@@ -0,0 +1,385 @@
+// Replays a recorded accelerometer/gyro log through the sensor path at full
+// speed: calculate_angles(), the pitch and roll Kalman filters and, when the
+// log has gyro columns, the AHRS.
+//
+// Build from the lib folder:
+//   gcc -O2 -IcordicMath/include -IKalman/include -IIMU/include IMU_replay.c cordicMath/src/*.c Kalman/src/*.c IMU/src/*.c -o imu_replay -lpthread
+//
+// Usage:
+//   imu_replay [-c columns] log        replay a log
+//   imu_replay -g rows log             write a synthetic binary log with 6 columns
+//
+// A log is rows of ax ay az [gx gy gz], the acceleration in g and the rate
+// in degrees per second, the same rows as measurements[][3] in
+// Kalman_Filter_test.c. A binary log holds them as int32 fixedpoint
+// according to CORDIC_MATH_FRACTION_BITS in host byte order. It starts
+// with a header of two int32, LOG_MAGIC and the number of columns, as -g
+// writes it. A raw log without the header is read with -c columns
+// (default 3); a file that is not a whole number of rows, or a header that
+// disagrees with -c, is rejected. A log that ends in .csv is text, one row
+// per line separated by commas; lines that do not start with a number are
+// skipped, the columns are taken from the first row.
+//
+// The file is memory mapped. Binary rows are read in place, the stages get
+// pointers into the mapping. CSV rows are parsed a block at a time straight
+// from the mapping into a block buffer. The time of every stage is summed
+// over the blocks, the checksums (FNV-1a over the outputs) show whether a
+// change of the code changed the results.
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ahrs.h"
+#include "cordic-math.h"
+#include "imu.h"
+#include "kalman.h"
+
+#define REPLAY_BLOCK 4096
+#define MAX_COLUMNS 6
+#define SAMPLE_RATE 1000
+/* "IMUL" in little endian, far above any acceleration in the first column
+ * of a raw log */
+#define LOG_MAGIC 0x4c554d49
+
+enum { STAGE_PARSE, STAGE_ANGLES, STAGE_KALMAN, STAGE_AHRS, STAGES };
+
+static const char *stage_names[STAGES] = {"parse", "calculate_angles", "kalman bank", "ahrs"};
+
+typedef struct {
+    const char *data;   /* the mapping */
+    size_t size;
+    size_t offset;      /* CSV: the next byte to parse */
+    int32_t csv;
+    int32_t columns;
+    const int32_t *values; /* binary: the first row, after the header */
+    int64_t rows;       /* binary: the number of rows */
+    int64_t row;        /* binary: the next row */
+} ReplayLog;
+
+typedef struct {
+    int64_t time[STAGES];
+    uint64_t checksum[STAGES];
+    int64_t rows;
+} ReplayStats;
+
+static uint64_t fnv1a(uint64_t hash, const int32_t values[], int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        uint32_t v = (uint32_t)values[i];
+        for (int32_t b = 0; b < 4; b++) {
+            hash ^= (v >> (8 * b)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+// Parses a decimal number such as -0.98 to fixedpoint without floats,
+// returns the position after it
+static const char *parse_fixed(const char *s, const char *end, int32_t *value) {
+    int64_t integer = 0, fraction = 0, scale = 1;
+    int32_t negative = 0;
+
+    while (s < end && (*s == ' ' || *s == '\t')) {
+        s++;
+    }
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+    while (s < end && *s >= '0' && *s <= '9') {
+        integer = integer * 10 + (*s++ - '0');
+    }
+    if (s < end && *s == '.') {
+        s++;
+        while (s < end && *s >= '0' && *s <= '9') {
+            /* Digits past the ninth are below the resolution */
+            if (scale < 1000000000) {
+                fraction = fraction * 10 + (*s - '0');
+                scale *= 10;
+            }
+            s++;
+        }
+    }
+    integer = (integer << CORDIC_MATH_FRACTION_BITS) +
+              ((fraction << CORDIC_MATH_FRACTION_BITS) + scale / 2) / scale;
+    *value = (int32_t)(negative ? -integer : integer);
+    return s;
+}
+
+static int32_t is_number_start(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+// Counts the columns of the first data row of a CSV log
+static int32_t csv_columns(const char *s, const char *end) {
+    while (s < end) {
+        const char *line = s;
+        int32_t columns = 1;
+
+        while (s < end && *s != '\n') {
+            columns += *s == ',';
+            s++;
+        }
+        s++;
+        while (line < end && (*line == ' ' || *line == '\t')) {
+            line++;
+        }
+        if (line < end && is_number_start(*line)) {
+            return columns;
+        }
+    }
+    return 0;
+}
+
+// Parses up to REPLAY_BLOCK rows of a CSV log into rows, returns the count
+static int32_t csv_block(ReplayLog *log, int32_t rows[]) {
+    const char *s = log->data + log->offset, *end = log->data + log->size;
+    int32_t count = 0;
+
+    while (s < end && count < REPLAY_BLOCK) {
+        const char *line_end = memchr(s, '\n', (size_t)(end - s));
+        const char *t = s;
+
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        while (t < line_end && (*t == ' ' || *t == '\t')) {
+            t++;
+        }
+        if (t < line_end && is_number_start(*t)) {
+            int32_t *row = &rows[count * log->columns];
+            for (int32_t c = 0; c < log->columns; c++) {
+                t = parse_fixed(t, line_end, &row[c]);
+                while (t < line_end && *t != ',') {
+                    t++;
+                }
+                t++;
+            }
+            count++;
+        }
+        s = line_end + 1;
+    }
+    log->offset = (size_t)(s - log->data);
+    return count;
+}
+
+// Maps a log. columns is the value of -c, 0 when it was not given
+static int32_t open_log(ReplayLog *log, const char *path, int32_t columns) {
+    struct stat st;
+    size_t length = strlen(path), header = 0;
+    int fd = open(path, O_RDONLY);
+
+    memset(log, 0, sizeof(ReplayLog));
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    log->size = (size_t)st.st_size;
+    log->data = mmap(NULL, log->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (log->data == MAP_FAILED) {
+        return -1;
+    }
+    madvise((void *)log->data, log->size, MADV_SEQUENTIAL);
+
+    log->csv = length > 4 && strcmp(path + length - 4, ".csv") == 0;
+    if (log->csv) {
+        log->columns = csv_columns(log->data, log->data + log->size);
+    } else if (log->size >= 2 * sizeof(int32_t) && ((const int32_t *)log->data)[0] == LOG_MAGIC) {
+        header = 2 * sizeof(int32_t);
+        log->columns = ((const int32_t *)log->data)[1];
+        if (columns != 0 && columns != log->columns) {
+            log->columns = 0;
+        }
+    } else {
+        log->columns = columns != 0 ? columns : 3;
+    }
+    if ((log->columns != 3 && log->columns != MAX_COLUMNS) ||
+        (!log->csv && (log->size - header) % (sizeof(int32_t) * log->columns) != 0)) {
+        munmap((void *)log->data, log->size);
+        return -1;
+    }
+    log->values = (const int32_t *)(log->data + header);
+    log->rows = log->csv ? 0 : (int64_t)((log->size - header) / (sizeof(int32_t) * log->columns));
+    return 0;
+}
+
+// The next block of rows, a pointer into the mapping for a binary log
+static int32_t next_block(ReplayLog *log, int32_t buffer[], const int32_t **rows) {
+    int64_t count;
+
+    if (log->csv) {
+        *rows = buffer;
+        return csv_block(log, buffer);
+    }
+    count = log->rows - log->row;
+    if (count > REPLAY_BLOCK) {
+        count = REPLAY_BLOCK;
+    }
+    *rows = log->values + log->row * log->columns;
+    log->row += count;
+    return (int32_t)count;
+}
+
+static int32_t replay(ReplayLog *log, ReplayStats *stats) {
+    static int32_t buffer[REPLAY_BLOCK * MAX_COLUMNS];
+    static int32_t angles[REPLAY_BLOCK * 2];    /* pitch and roll of every row */
+    static int32_t filtered[REPLAY_BLOCK * 2];
+    static AhrsEuler euler[REPLAY_BLOCK];
+    const int32_t *rows;
+    int32_t columns = log->columns, count;
+    KalmanBank bank;
+    Ahrs ahrs;
+
+    /* The pitch and roll filter are two channels of one bank */
+    if (kalman_bank_init(&bank, 2, 1 << 10, 1 << 14, 0) != 0) {
+        return -1;
+    }
+    ahrs_init(&ahrs, SAMPLE_RATE, 1 << 16, 6554);
+    memset(stats, 0, sizeof(ReplayStats));
+    for (int32_t s = 0; s < STAGES; s++) {
+        stats->checksum[s] = 0xcbf29ce484222325ull;
+    }
+
+    for (;;) {
+        int64_t t0 = imu_now(), t1, t2, t3, t4;
+
+        count = next_block(log, buffer, &rows);
+        if (count == 0) {
+            break;
+        }
+        t1 = imu_now();
+        for (int32_t i = 0; i < count; i++) {
+            const int32_t *row = &rows[i * columns];
+            calculate_angles(row[0], row[1], row[2], &angles[2 * i], &angles[2 * i + 1]);
+        }
+        t2 = imu_now();
+        for (int32_t i = 0; i < count; i++) {
+            kalman_bank_update(&bank, &angles[2 * i], 2);
+            filtered[2 * i] = bank.x[0];
+            filtered[2 * i + 1] = bank.x[1];
+        }
+        t3 = imu_now();
+        if (columns == MAX_COLUMNS) {
+            for (int32_t i = 0; i < count; i++) {
+                const int32_t *row = &rows[i * columns];
+                AhrsFrame frame = {row[3], row[4], row[5], row[0], row[1], row[2], 0, 0, 0};
+                ahrs_update(&ahrs, &frame);
+                ahrs_euler(&ahrs, &euler[i]);
+            }
+        }
+        t4 = imu_now();
+
+        stats->time[STAGE_PARSE] += t1 - t0;
+        stats->time[STAGE_ANGLES] += t2 - t1;
+        stats->time[STAGE_KALMAN] += t3 - t2;
+        stats->time[STAGE_AHRS] += t4 - t3;
+        stats->checksum[STAGE_PARSE] = fnv1a(stats->checksum[STAGE_PARSE], rows, count * columns);
+        stats->checksum[STAGE_ANGLES] = fnv1a(stats->checksum[STAGE_ANGLES], angles, count * 2);
+        stats->checksum[STAGE_KALMAN] = fnv1a(stats->checksum[STAGE_KALMAN], filtered, count * 2);
+        if (columns == MAX_COLUMNS) {
+            stats->checksum[STAGE_AHRS] =
+                fnv1a(stats->checksum[STAGE_AHRS], (const int32_t *)euler, count * 3);
+        }
+        stats->rows += count;
+    }
+    kalman_bank_free(&bank);
+    return 0;
+}
+
+// A slow tumble with vibration, in the binary format with 6 columns
+static int32_t generate(const char *path, int64_t rows) {
+    FILE *file = fopen(path, "wb");
+    int32_t block[REPLAY_BLOCK * MAX_COLUMNS];
+    const int32_t header[2] = {LOG_MAGIC, MAX_COLUMNS};
+
+    if (file == NULL) {
+        return -1;
+    }
+    if (fwrite(header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return -1;
+    }
+    for (int64_t i = 0; i < rows; i += REPLAY_BLOCK) {
+        int32_t count = rows - i < REPLAY_BLOCK ? (int32_t)(rows - i) : REPLAY_BLOCK;
+        for (int32_t j = 0; j < count; j++) {
+            int64_t n = i + j;
+            int32_t *row = &block[j * MAX_COLUMNS];
+            /* Degrees, the tumble repeats every 36 seconds */
+            int32_t angle = (int32_t)(((n * 10 % (360 * SAMPLE_RATE)) << CORDIC_MATH_FRACTION_BITS) /
+                                      SAMPLE_RATE);
+            int32_t noise = (int32_t)((n * 7919) % 2048 - 1024) << 2;
+            row[0] = (cordic_sin(angle) >> 2) + noise;
+            row[1] = (cordic_cos(angle) >> 3) - noise;
+            row[2] = (1 << CORDIC_MATH_FRACTION_BITS) + noise / 2;
+            row[3] = 10 << CORDIC_MATH_FRACTION_BITS;
+            row[4] = noise << 4;
+            row[5] = -(noise << 3);
+        }
+        if (fwrite(block, sizeof(int32_t) * MAX_COLUMNS, (size_t)count, file) != (size_t)count) {
+            fclose(file);
+            return -1;
+        }
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    ReplayLog log;
+    ReplayStats stats;
+    int64_t t0, t1, total = 0;
+    int32_t columns = 0;
+
+    if (argc == 4 && strcmp(argv[1], "-g") == 0) {
+        if (generate(argv[3], atoll(argv[2])) != 0) {
+            fprintf(stderr, "could not write %s\n", argv[3]);
+            return 1;
+        }
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+        columns = atoi(argv[2]);
+    } else if (argc != 2) {
+        fprintf(stderr, "usage: %s [-c columns] log\n       %s -g rows log\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (open_log(&log, argv[argc - 1], columns) != 0) {
+        fprintf(stderr, "could not map %s as a log with 3 or 6 columns, or the size is not "
+                "a whole number of rows\n", argv[argc - 1]);
+        return 1;
+    }
+
+    t0 = imu_now();
+    if (replay(&log, &stats) != 0) {
+        fprintf(stderr, "out of memory\n");
+        munmap((void *)log.data, log.size);
+        return 1;
+    }
+    t1 = imu_now();
+    munmap((void *)log.data, log.size);
+
+    printf("%lld rows, %d columns, %s, %.1f MB\n", (long long)stats.rows, log.columns,
+           log.csv ? "csv" : "binary", log.size * 1e-6);
+    printf("%-18s %12s %10s %18s\n", "stage", "ns/sample", "share", "checksum");
+    for (int32_t s = 0; s < STAGES; s++) {
+        total += stats.time[s];
+    }
+    for (int32_t s = 0; s < STAGES; s++) {
+        if (s == STAGE_AHRS && log.columns != MAX_COLUMNS) {
+            continue;
+        }
+        printf("%-18s %12.1f %9.1f%%   %016llx\n", stage_names[s],
+               stats.rows ? (double)stats.time[s] / stats.rows : 0.0,
+               total ? 100.0 * stats.time[s] / total : 0.0,
+               (unsigned long long)stats.checksum[s]);
+    }
+    printf("%.2f Msamples/s\n", stats.rows / ((t1 - t0) * 1e-9) * 1e-6);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "stdint.h"
+#include "kalman.h"
+
+/**
+ * @brief The largest dimensions of a KalmanMatrix. The matrices are stored
+ * at the full size so the kernels can be specialized for every number of
+ * states without any allocation.
+ */
+#define KALMAN_MATRIX_MAX_STATES 8
+#define KALMAN_MATRIX_MAX_MEASUREMENTS 4
+#define KALMAN_MATRIX_MAX_INPUTS 4
+
+/* Kalman filter with several states, every matrix element is fixedpoint
+ * according to KALMAN_FRACTION_BITS.
+ *   predict: x = F x + B u,  P = F P F' + Q
+ *   update:  K = P H' (H P H' + R)^-1,  x = x + K (z - H x),
+ *            P = (I - K H) P (I - K H)' + K R K' */
+typedef struct {
+    int32_t states;
+    int32_t measurements;
+    int32_t inputs;
+    int32_t F[KALMAN_MATRIX_MAX_STATES][KALMAN_MATRIX_MAX_STATES];       /* state transition */
+    int32_t B[KALMAN_MATRIX_MAX_STATES][KALMAN_MATRIX_MAX_INPUTS];       /* control input */
+    int32_t H[KALMAN_MATRIX_MAX_MEASUREMENTS][KALMAN_MATRIX_MAX_STATES]; /* measurement */
+    int32_t Q[KALMAN_MATRIX_MAX_STATES][KALMAN_MATRIX_MAX_STATES];       /* process noise covariance */
+    int32_t R[KALMAN_MATRIX_MAX_MEASUREMENTS][KALMAN_MATRIX_MAX_MEASUREMENTS]; /* measurement noise covariance */
+    int32_t x[KALMAN_MATRIX_MAX_STATES];                                 /* estimated state */
+    int32_t P[KALMAN_MATRIX_MAX_STATES][KALMAN_MATRIX_MAX_STATES];       /* estimation error covariance */
+    int32_t K[KALMAN_MATRIX_MAX_STATES][KALMAN_MATRIX_MAX_MEASUREMENTS]; /* gain of the last update */
+} KalmanMatrix;
+
+int32_t kalman_matrix_init(KalmanMatrix *kf, int32_t states, int32_t measurements,
+                           int32_t inputs);
+int32_t kalman_matrix_predict(KalmanMatrix *kf, const int32_t u[]);
+int32_t kalman_matrix_update(KalmanMatrix *kf, const int32_t z[]);
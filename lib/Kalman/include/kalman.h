@@ -0,0 +1,43 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief KALMAN_FRACTION_BITS is the number of bits represented by the
+ * decimals, the same format as CORDIC_MATH_FRACTION_BITS so the angles from
+ * the Cordic library can be filtered directly.
+ */
+#define KALMAN_FRACTION_BITS 16
+/* Structure to hold the state of one scalar Kalman filter */
+typedef struct {
+    int32_t q; /* Process noise covariance */
+    int32_t r; /* Measurement noise covariance */
+    int32_t x; /* Estimated value */
+    int32_t p; /* Estimation error covariance */
+    int32_t k; /* Kalman gain */
+    int32_t steady_gain; /* The gain the filter converges to with this q and r */
+    int32_t steady; /* Nonzero once the filter runs with the steady gain */
+} KalmanFilter;
+
+/* Many independent scalar filters, every field is an array over the
+ * channels so one update runs over contiguous memory */
+typedef struct {
+    int32_t channels;
+    int32_t *q;
+    int32_t *r;
+    int32_t *x;
+    int32_t *p;
+    int32_t *k;
+    int32_t *steady_gain;
+    int32_t *steady;
+    int32_t settled;  /* channels that run with a constant gain */
+} KalmanBank;
+
+void kalman_init(KalmanFilter *kf, int32_t q, int32_t r, int32_t initial_value);
+void kalman_set_noise(KalmanFilter *kf, int32_t q, int32_t r);
+void kalman_update(KalmanFilter *kf, int32_t measurement);
+int32_t kalman_bank_init(KalmanBank *bank, int32_t channels, int32_t q, int32_t r,
+                         int32_t initial_value);
+int32_t kalman_bank_set_noise(KalmanBank *bank, int32_t channel, int32_t q, int32_t r);
+int32_t kalman_bank_update(KalmanBank *bank, const int32_t measurements[], int32_t n);
+void kalman_bank_free(KalmanBank *bank);
@@ -0,0 +1,175 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "kalman-matrix.h"
+
+#define KALMAN_ONE (1 << KALMAN_FRACTION_BITS)
+#define KALMAN_HALF ((int64_t)1 << (KALMAN_FRACTION_BITS - 1))
+#define MAX_STATES KALMAN_MATRIX_MAX_STATES
+#define MAX_MEASUREMENTS KALMAN_MATRIX_MAX_MEASUREMENTS
+
+/**
+ * @brief Rounds a sum of products of two fixedpoint numbers back to
+ * KALMAN_FRACTION_BITS. The sums are kept in 64 bits until this point so
+ * a row times a column is rounded once.
+ */
+static inline int32_t round_sum(int64_t sum) {
+    return (int32_t)((sum + KALMAN_HALF) >> KALMAN_FRACTION_BITS);
+}
+
+/**
+ * @brief Fixed-point multiplication with a 64 bit intermediate.
+ */
+static inline int32_t fixed_mul(int32_t a, int32_t b) {
+    return round_sum((int64_t)a * b);
+}
+
+/**
+ * @brief Fixed-point division with a 64 bit intermediate.
+ */
+static inline int32_t fixed_div(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a << KALMAN_FRACTION_BITS) / b);
+}
+
+/**
+ * @brief Factors the symmetric m x m matrix S as L D L' with a unit lower
+ * triangular L, the Cholesky factorization without square roots.
+ *
+ * @return 0 on success, -1 if S is not positive definite.
+ */
+static int32_t factor_ldl(const int32_t S[][MAX_MEASUREMENTS], int32_t L[][MAX_MEASUREMENTS],
+                          int32_t D[], int32_t m) {
+    for (int32_t j = 0; j < m; j++) {
+        int64_t sum = (int64_t)S[j][j] << KALMAN_FRACTION_BITS;
+        for (int32_t k = 0; k < j; k++) {
+            sum -= (int64_t)fixed_mul(L[j][k], L[j][k]) * D[k];
+        }
+        D[j] = round_sum(sum);
+        if (D[j] <= 0) {
+            return -1;
+        }
+        L[j][j] = KALMAN_ONE;
+        for (int32_t i = j + 1; i < m; i++) {
+            sum = (int64_t)S[i][j] << KALMAN_FRACTION_BITS;
+            for (int32_t k = 0; k < j; k++) {
+                sum -= (int64_t)fixed_mul(L[i][k], L[j][k]) * D[k];
+            }
+            L[i][j] = fixed_div(round_sum(sum), D[j]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Solves L D L' y = b in place: L w = b by forward substitution,
+ * then y = D^-1 w, then L' y = D^-1 w by back substitution. The forward
+ * pass has to run on the undivided w, the division only comes after it.
+ */
+static void solve_ldl(const int32_t L[][MAX_MEASUREMENTS], const int32_t D[], int32_t y[],
+                      int32_t m) {
+    for (int32_t i = 0; i < m; i++) {
+        int64_t sum = (int64_t)y[i] << KALMAN_FRACTION_BITS;
+        for (int32_t k = 0; k < i; k++) {
+            sum -= (int64_t)L[i][k] * y[k];
+        }
+        y[i] = round_sum(sum);
+    }
+    for (int32_t i = 0; i < m; i++) {
+        y[i] = fixed_div(y[i], D[i]);
+    }
+    for (int32_t i = m - 1; i >= 0; i--) {
+        int64_t sum = (int64_t)y[i] << KALMAN_FRACTION_BITS;
+        for (int32_t k = i + 1; k < m; k++) {
+            sum -= (int64_t)L[k][i] * y[k];
+        }
+        y[i] = round_sum(sum);
+    }
+}
+
+/* One copy of the kernels per number of states */
+#define KALMAN_MATRIX_N 1
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 2
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 3
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 4
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 5
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 6
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 7
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+#define KALMAN_MATRIX_N 8
+#include "kalman-matrix-kernels.inc"
+#undef KALMAN_MATRIX_N
+
+static void (*const predict_sized[MAX_STATES + 1])(KalmanMatrix *, const int32_t[]) = {
+    NULL, predict_1, predict_2, predict_3, predict_4, predict_5, predict_6, predict_7, predict_8};
+static int32_t (*const update_sized[MAX_STATES + 1])(KalmanMatrix *, const int32_t[]) = {
+    NULL, update_1, update_2, update_3, update_4, update_5, update_6, update_7, update_8};
+
+/**
+ * @brief Initializes a Kalman filter with several states. F and P start as
+ * the identity, every other matrix and the state as zero, fill in F, B, H,
+ * Q and R afterwards.
+ *
+ * @param kf the filter.
+ * @param states the number of states, at most KALMAN_MATRIX_MAX_STATES.
+ * @param measurements the number of measurements per update, at most
+ * KALMAN_MATRIX_MAX_MEASUREMENTS.
+ * @param inputs the number of control inputs, at most KALMAN_MATRIX_MAX_INPUTS.
+ *
+ * @return 0 on success, -1 if a dimension is out of range.
+ */
+int32_t kalman_matrix_init(KalmanMatrix *kf, int32_t states, int32_t measurements,
+                           int32_t inputs) {
+    memset(kf, 0, sizeof(KalmanMatrix));
+    if (states < 1 || states > MAX_STATES || measurements < 1 ||
+        measurements > MAX_MEASUREMENTS || inputs < 0 || inputs > KALMAN_MATRIX_MAX_INPUTS) {
+        return -1;
+    }
+    kf->states = states;
+    kf->measurements = measurements;
+    kf->inputs = inputs;
+    for (int32_t i = 0; i < states; i++) {
+        kf->F[i][i] = KALMAN_ONE;
+        kf->P[i][i] = KALMAN_ONE;
+    }
+    return 0;
+}
+
+/**
+ * @brief The prediction step, x = F x + B u and P = F P F' + Q.
+ *
+ * @param kf the filter.
+ * @param u the control inputs, NULL if there are none.
+ *
+ * @return 0
+ */
+int32_t kalman_matrix_predict(KalmanMatrix *kf, const int32_t u[]) {
+    predict_sized[kf->states](kf, u);
+    return 0;
+}
+
+/**
+ * @brief The measurement update. The gain is solved through an L D L'
+ * factorization of the innovation covariance instead of an inverse.
+ *
+ * @param kf the filter.
+ * @param z the measurements, fixedpoint according to KALMAN_FRACTION_BITS.
+ *
+ * @return 0 on success, -1 if H P H' + R is not positive definite, the
+ * filter is left unchanged.
+ */
+int32_t kalman_matrix_update(KalmanMatrix *kf, const int32_t z[]) {
+    return update_sized[kf->states](kf, z);
+}
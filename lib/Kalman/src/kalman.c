@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "kalman.h"
+
+#define KALMAN_ONE (1 << KALMAN_FRACTION_BITS)
+
+/**
+ * @brief Fixed-point multiplication with a 64 bit intermediate, the product
+ * of two Q16 numbers does not fit in 32 bits.
+ */
+static inline int32_t fixed_mul(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> KALMAN_FRACTION_BITS);
+}
+
+/**
+ * @brief Fixed-point division with a 64 bit intermediate.
+ */
+static inline int32_t fixed_div(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a << KALMAN_FRACTION_BITS) / b);
+}
+
+/**
+ * @brief The gain p / d for 0 <= p <= d, calculated bit by bit as a
+ * restoring division. Every step is a shift, a compare and a subtraction
+ * without branches, so the loop over the channels vectorizes where a
+ * hardware division would not. Without vectorization the division is
+ * faster, kalman_update() uses fixed_div() which gives the same result.
+ * d must stay below 2^30.
+ *
+ * @return p / d, fixedpoint according to KALMAN_FRACTION_BITS.
+ */
+static inline int32_t kalman_gain(int32_t p, int32_t d) {
+    int32_t remainder = p, k = 0;
+
+    for (int32_t bit = KALMAN_FRACTION_BITS; bit >= 0; bit--) {
+        int32_t fits = remainder >= d;
+        remainder -= fits ? d : 0;
+        k |= fits << bit;
+        remainder <<= 1;
+    }
+    return k;
+}
+
+/**
+ * @brief Integer square root, rounded down.
+ */
+static uint64_t isqrt(uint64_t value) {
+    uint64_t root = 0, bit = (uint64_t)1 << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+ * @brief The gain the filter converges to with constant q and r. The
+ * predicted covariance of the steady state solves the Riccati equation
+ * p = q + p r / (p + r), so p = (q + sqrt(q^2 + 4 q r)) / 2 and the gain is
+ * p / (p + r), truncated like the gain of the full update.
+ *
+ * @return The steady state gain, fixedpoint according to KALMAN_FRACTION_BITS.
+ */
+static int32_t steady_state_gain(int32_t q, int32_t r) {
+    uint64_t square = (uint64_t)q * q + 4 * (uint64_t)q * r;
+    int32_t shift = 0;
+    int64_t p;
+
+    /* Up to 16 extra bits for p, the integer part alone is off by 2 LSB
+     * of the gain when p is small */
+    while (shift < 16 && square < ((uint64_t)1 << 60)) {
+        square <<= 2;
+        shift++;
+    }
+    p = (((int64_t)q << shift) + (int64_t)isqrt(square)) / 2;
+    return (int32_t)((p << KALMAN_FRACTION_BITS) / (p + ((int64_t)r << shift)));
+}
+
+/**
+ * @brief Initializes a scalar Kalman filter.
+ *
+ * @param kf the filter.
+ * @param q the process noise covariance, fixedpoint according to KALMAN_FRACTION_BITS.
+ * @param r the measurement noise covariance, fixedpoint according to KALMAN_FRACTION_BITS.
+ * @param initial_value the first estimate, fixedpoint according to KALMAN_FRACTION_BITS.
+ */
+void kalman_init(KalmanFilter *kf, int32_t q, int32_t r, int32_t initial_value) {
+    kf->q = q;
+    kf->r = r;
+    kf->x = initial_value;
+    kf->p = KALMAN_ONE; /* Initialize p with 1 in fixed-point */
+    kf->k = 0;
+    kf->steady_gain = steady_state_gain(q, r);
+    kf->steady = 0;
+}
+
+/**
+ * @brief Changes the noise covariances, the estimate is kept. A filter
+ * that runs with a constant gain goes back to the full update until the
+ * gain has reached the new steady state gain.
+ *
+ * @param kf the filter.
+ * @param q the process noise covariance, fixedpoint according to KALMAN_FRACTION_BITS.
+ * @param r the measurement noise covariance, fixedpoint according to KALMAN_FRACTION_BITS.
+ */
+void kalman_set_noise(KalmanFilter *kf, int32_t q, int32_t r) {
+    kf->q = q;
+    kf->r = r;
+    kf->steady_gain = steady_state_gain(q, r);
+    kf->steady = 0;
+}
+
+/**
+ * @brief Updates the filter with a new measurement. Once the gain is within
+ * one LSB of the steady state gain, k is set to it, p is frozen and an
+ * update is a single multiplication without the division. A slowly
+ * converging gain changes by less than one LSB per update long before it
+ * arrives, so the gain is compared to its limit rather than to the last
+ * update. With q and r of a few LSB the rounding of p stops the gain short
+ * of the limit, the filter also freezes when p no longer changes. Change q and r
+ * with kalman_set_noise() so the filter leaves the steady state.
+ *
+ * @param kf the filter.
+ * @param measurement fixedpoint according to KALMAN_FRACTION_BITS.
+ */
+void kalman_update(KalmanFilter *kf, int32_t measurement) {
+    int32_t gain, p;
+
+    if (kf->steady) {
+        kf->x = kf->x + fixed_mul(kf->k, measurement - kf->x);
+        return;
+    }
+
+    /* Prediction update */
+    p = kf->p + kf->q;
+
+    /* Measurement update */
+    gain = fixed_div(p, p + kf->r);
+    kf->steady = gain - kf->steady_gain <= 1 && kf->steady_gain - gain <= 1;
+    kf->k = kf->steady ? kf->steady_gain : gain;
+    kf->x = kf->x + fixed_mul(kf->k, measurement - kf->x);
+    p = fixed_mul(KALMAN_ONE - kf->k, p);
+    kf->steady |= p == kf->p;
+    kf->p = p;
+}
+
+/**
+ * @brief Sets up a bank of independent scalar filters that all start with
+ * the same noise covariances and estimate.
+ *
+ * @param bank the KalmanBank to set up.
+ * @param channels the number of filters.
+ * @param q the process noise covariance, fixedpoint according to KALMAN_FRACTION_BITS.
+ * @param r the measurement noise covariance, fixedpoint according to KALMAN_FRACTION_BITS.
+ * @param initial_value the first estimate, fixedpoint according to KALMAN_FRACTION_BITS.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t kalman_bank_init(KalmanBank *bank, int32_t channels, int32_t q, int32_t r,
+                         int32_t initial_value) {
+    memset(bank, 0, sizeof(KalmanBank));
+    if (channels < 1) {
+        return -1;
+    }
+    bank->channels = channels;
+    bank->q = malloc(sizeof(int32_t) * channels);
+    bank->r = malloc(sizeof(int32_t) * channels);
+    bank->x = malloc(sizeof(int32_t) * channels);
+    bank->p = malloc(sizeof(int32_t) * channels);
+    bank->k = malloc(sizeof(int32_t) * channels);
+    bank->steady_gain = malloc(sizeof(int32_t) * channels);
+    bank->steady = malloc(sizeof(int32_t) * channels);
+    if (bank->q == NULL || bank->r == NULL || bank->x == NULL || bank->p == NULL ||
+        bank->k == NULL || bank->steady_gain == NULL || bank->steady == NULL) {
+        kalman_bank_free(bank);
+        return -1;
+    }
+    for (int32_t i = 0; i < channels; i++) {
+        bank->q[i] = q;
+        bank->r[i] = r;
+        bank->x[i] = initial_value;
+        bank->p[i] = KALMAN_ONE;
+        bank->k[i] = 0;
+        bank->steady_gain[i] = steady_state_gain(q, r);
+        bank->steady[i] = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Changes the noise covariances of one channel, the estimate is kept.
+ * Like kalman_set_noise() the channel leaves the steady state.
+ *
+ * @return 0 on success, -1 if the channel does not exist.
+ */
+int32_t kalman_bank_set_noise(KalmanBank *bank, int32_t channel, int32_t q, int32_t r) {
+    if (channel < 0 || channel >= bank->channels) {
+        return -1;
+    }
+    bank->q[channel] = q;
+    bank->r[channel] = r;
+    bank->steady_gain[channel] = steady_state_gain(q, r);
+    if (bank->steady[channel]) {
+        bank->settled--;
+    }
+    bank->steady[channel] = 0;
+    return 0;
+}
+
+/**
+ * @brief The full update of kalman_bank_update(), the arrays are parameters
+ * so restrict tells the compiler they do not overlap. A channel in the
+ * steady state keeps its p and k, the selects instead of branches keep the
+ * loop vectorized.
+ *
+ * @return The number of channels that reached the steady state.
+ */
+static int32_t update_channels(const int32_t *restrict q, const int32_t *restrict r,
+                               int32_t *restrict x, int32_t *restrict p, int32_t *restrict k,
+                               const int32_t *restrict steady_gain, int32_t *restrict steady,
+                               const int32_t *restrict z, int32_t n) {
+    int32_t settled = 0;
+
+    for (int32_t i = 0; i < n; i++) {
+        int32_t predicted = p[i] + q[i];
+        int32_t gain = kalman_gain(predicted, predicted + r[i]);
+        int32_t frozen = steady[i] != 0;
+        int32_t arrived = (gain - steady_gain[i] <= 1) & (steady_gain[i] - gain <= 1);
+        int32_t keep = -frozen; /* all bits set in the steady state */
+        int32_t hold = -(frozen | arrived);
+        int32_t updated;
+
+        gain = (k[i] & keep) | (steady_gain[i] & hold & ~keep) | (gain & ~hold);
+        updated = fixed_mul(KALMAN_ONE - gain, predicted);
+        arrived |= updated == p[i];
+        x[i] = x[i] + fixed_mul(gain, z[i] - x[i]);
+        p[i] = (p[i] & keep) | (updated & ~keep);
+        k[i] = gain;
+        settled += (!frozen) & arrived;
+        steady[i] = frozen | arrived;
+    }
+    return settled;
+}
+
+/**
+ * @brief The update once every channel runs with a constant gain, only the
+ * estimate changes.
+ */
+static void update_steady_channels(const int32_t *restrict k, int32_t *restrict x,
+                                   const int32_t *restrict z, int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        x[i] = x[i] + fixed_mul(k[i], z[i] - x[i]);
+    }
+}
+
+/**
+ * @brief Updates the first n channels with one measurement each. The
+ * predict and update steps are the same as kalman_update(), run as one loop
+ * over the arrays of the bank so the compiler vectorizes it across the
+ * channels. When every channel of the bank has reached the steady state
+ * the division and the covariance update are skipped altogether.
+ *
+ * @param bank the KalmanBank.
+ * @param measurements one measurement per channel, fixedpoint according to
+ * KALMAN_FRACTION_BITS.
+ * @param n the number of channels to update, at most bank->channels.
+ *
+ * @return 0 on success, -1 if n is out of range.
+ */
+int32_t kalman_bank_update(KalmanBank *bank, const int32_t measurements[], int32_t n) {
+    if (n < 0 || n > bank->channels) {
+        return -1;
+    }
+    if (bank->settled == bank->channels) {
+        update_steady_channels(bank->k, bank->x, measurements, n);
+    } else {
+        bank->settled += update_channels(bank->q, bank->r, bank->x, bank->p, bank->k,
+                                         bank->steady_gain, bank->steady, measurements, n);
+    }
+    return 0;
+}
+
+/**
+ * @brief Frees the memory allocated by kalman_bank_init().
+ */
+void kalman_bank_free(KalmanBank *bank) {
+    free(bank->q);
+    free(bank->r);
+    free(bank->x);
+    free(bank->p);
+    free(bank->k);
+    free(bank->steady_gain);
+    free(bank->steady);
+    bank->q = NULL;
+    bank->r = NULL;
+    bank->x = NULL;
+    bank->p = NULL;
+    bank->k = NULL;
+    bank->steady_gain = NULL;
+    bank->steady = NULL;
+}
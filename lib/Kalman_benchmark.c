@@ -0,0 +1,354 @@
+// Benchmarks for the Kalman library.
+//
+// Build from the lib folder:
+//   gcc -O3 -march=native -IKalman/include Kalman_benchmark.c Kalman/src/*.c -o kalman_benchmark -lm
+//
+// Timings are wall clock. The bank only vectorizes with -O3 or
+// -ftree-vectorize.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "kalman.h"
+#include "kalman-matrix.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define MEASUREMENT_SETS 8
+
+static void fill_measurements(int32_t z[], int32_t channels) {
+    for (int32_t s = 0; s < MEASUREMENT_SETS; s++) {
+        for (int32_t i = 0; i < channels; i++) {
+            z[s * channels + i] = ((i * 7919 + s * 104729) % 4096 - 2048) << 4;
+        }
+    }
+}
+
+// Runs steps updates of every scalar filter, clearing steady first keeps
+// a filter on the full update
+static double run_scalar(KalmanFilter filters[], const int32_t z[], int32_t channels,
+                         int32_t steps, int32_t full) {
+    double t0 = now_seconds();
+
+    for (int32_t s = 0; s < steps; s++) {
+        const int32_t *step = &z[(s % MEASUREMENT_SETS) * channels];
+        for (int32_t i = 0; i < channels; i++) {
+            filters[i].steady &= !full;
+            kalman_update(&filters[i], step[i]);
+        }
+    }
+    return now_seconds() - t0;
+}
+
+// Runs steps updates of the bank, setting the noise of one channel every
+// update keeps the whole bank on the full update
+static double run_bank(KalmanBank *bank, const int32_t z[], int32_t channels, int32_t steps,
+                       int32_t full, int32_t q, int32_t r) {
+    double t0 = now_seconds();
+
+    for (int32_t s = 0; s < steps; s++) {
+        if (full) {
+            kalman_bank_set_noise(bank, 0, q, r);
+        }
+        kalman_bank_update(bank, &z[(s % MEASUREMENT_SETS) * channels], channels);
+    }
+    return now_seconds() - t0;
+}
+
+static void benchmark_bank(void) {
+    const int32_t q = 1 << 10, r = 1 << 14, warmup = 200, steps = 400;
+
+    printf("Kalman filter bank, million channel updates per second. Full keeps every\n"
+           "channel on the full update, steady runs after %d updates with the steady gain\n",
+           warmup);
+    printf("%-10s %16s %16s %16s %16s\n", "channels", "scalar, full", "scalar, steady",
+           "bank, full", "bank, steady");
+    for (int32_t channels = 1024; channels <= 65536; channels *= 4) {
+        KalmanFilter *filters = malloc(sizeof(KalmanFilter) * channels);
+        int32_t *z = malloc(sizeof(int32_t) * channels * MEASUREMENT_SETS);
+        double t_scalar_full, t_scalar_steady, t_bank_full, t_bank_steady;
+        int32_t settled = 0;
+        KalmanBank bank;
+
+        fill_measurements(z, channels);
+        for (int32_t i = 0; i < channels; i++) {
+            kalman_init(&filters[i], q, r, 0);
+        }
+        t_scalar_full = run_scalar(filters, z, channels, steps, 1);
+        for (int32_t i = 0; i < channels; i++) {
+            kalman_init(&filters[i], q, r, 0);
+        }
+        run_scalar(filters, z, channels, warmup, 0);
+        for (int32_t i = 0; i < channels; i++) {
+            settled += filters[i].steady != 0;
+        }
+        t_scalar_steady = run_scalar(filters, z, channels, steps, 0);
+
+        kalman_bank_init(&bank, channels, q, r, 0);
+        t_bank_full = run_bank(&bank, z, channels, steps, 1, q, r);
+        kalman_bank_free(&bank);
+
+        kalman_bank_init(&bank, channels, q, r, 0);
+        run_bank(&bank, z, channels, warmup, 0, q, r);
+        if (bank.settled != channels || settled != channels) {
+            printf("only %d and %d of %d channels settled\n", settled, bank.settled, channels);
+        }
+        t_bank_steady = run_bank(&bank, z, channels, steps, 0, q, r);
+
+        /* The bank has to give the same estimates as the scalar filters */
+        for (int32_t i = 0; i < channels; i++) {
+            if (bank.x[i] != filters[i].x) {
+                printf("channel %d differs: %d != %d\n", i, bank.x[i], filters[i].x);
+                break;
+            }
+        }
+        printf("%-10d %16.1f %16.1f %16.1f %16.1f\n", channels,
+               (double)channels * steps / t_scalar_full * 1e-6,
+               (double)channels * steps / t_scalar_steady * 1e-6,
+               (double)channels * steps / t_bank_full * 1e-6,
+               (double)channels * steps / t_bank_steady * 1e-6);
+        kalman_bank_free(&bank);
+        free(filters);
+        free(z);
+    }
+    printf("\n");
+}
+
+static void benchmark_matrix(void) {
+    const int32_t steps = 200000;
+
+    printf("Matrix Kalman filter, thousand predict and update steps per second\n");
+    printf("%-8s %14s %14s\n", "states", "1 measurement", "4 measurements");
+    for (int32_t n = 2; n <= KALMAN_MATRIX_MAX_STATES; n += 2) {
+        printf("%-8d", n);
+        for (int32_t m = 1; m <= 4; m += 3) {
+            int32_t z[KALMAN_MATRIX_MAX_MEASUREMENTS];
+            KalmanMatrix kf;
+            double t0, t;
+
+            /* Positions and velocities, the positions are measured */
+            kalman_matrix_init(&kf, n, m < n ? m : n, 0);
+            for (int32_t i = 0; i < n; i++) {
+                kf.Q[i][i] = 1 << 8;
+                if (i + 1 < n) {
+                    kf.F[i][i + 1] = 1 << 10;
+                }
+            }
+            for (int32_t i = 0; i < kf.measurements; i++) {
+                kf.H[i][i] = 1 << KALMAN_FRACTION_BITS;
+                kf.R[i][i] = 1 << 12;
+            }
+
+            t0 = now_seconds();
+            for (int32_t s = 0; s < steps; s++) {
+                for (int32_t i = 0; i < kf.measurements; i++) {
+                    z[i] = ((s * 7919 + i * 104729) % 4096 - 2048) << 4;
+                }
+                kalman_matrix_predict(&kf, NULL);
+                if (kalman_matrix_update(&kf, z) != 0) {
+                    printf("update failed at step %d\n", s);
+                    break;
+                }
+            }
+            t = now_seconds() - t0;
+            printf(" %14.1f", steps / t * 1e-3);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+#define CHECK_STATES 4
+#define CHECK_MEASUREMENTS 2
+
+// The matrix filter in double, S^-1 by Gauss-Jordan elimination
+typedef struct {
+    double F[CHECK_STATES][CHECK_STATES];
+    double H[CHECK_MEASUREMENTS][CHECK_STATES];
+    double Q[CHECK_STATES][CHECK_STATES];
+    double R[CHECK_MEASUREMENTS][CHECK_MEASUREMENTS];
+    double x[CHECK_STATES];
+    double P[CHECK_STATES][CHECK_STATES];
+    double K[CHECK_STATES][CHECK_MEASUREMENTS];
+} KalmanDouble;
+
+static void double_predict(KalmanDouble *f) {
+    const int32_t n = CHECK_STATES;
+    double x[CHECK_STATES] = {0}, FP[CHECK_STATES][CHECK_STATES] = {{0}};
+
+    for (int32_t i = 0; i < n; i++) {
+        for (int32_t k = 0; k < n; k++) {
+            x[i] += f->F[i][k] * f->x[k];
+            for (int32_t j = 0; j < n; j++) {
+                FP[i][j] += f->F[i][k] * f->P[k][j];
+            }
+        }
+    }
+    for (int32_t i = 0; i < n; i++) {
+        f->x[i] = x[i];
+        for (int32_t j = 0; j < n; j++) {
+            f->P[i][j] = f->Q[i][j];
+            for (int32_t k = 0; k < n; k++) {
+                f->P[i][j] += FP[i][k] * f->F[j][k];
+            }
+        }
+    }
+}
+
+static void double_update(KalmanDouble *f, const double z[]) {
+    const int32_t n = CHECK_STATES, m = CHECK_MEASUREMENTS;
+    double HP[CHECK_MEASUREMENTS][CHECK_STATES] = {{0}};
+    double S[CHECK_MEASUREMENTS][2 * CHECK_MEASUREMENTS] = {{0}};
+    double innovation[CHECK_MEASUREMENTS];
+    double A[CHECK_STATES][CHECK_STATES], P[CHECK_STATES][CHECK_STATES];
+
+    for (int32_t i = 0; i < m; i++) {
+        for (int32_t j = 0; j < n; j++) {
+            for (int32_t k = 0; k < n; k++) {
+                HP[i][j] += f->H[i][k] * f->P[k][j];
+            }
+        }
+        for (int32_t j = 0; j < m; j++) {
+            S[i][j] = f->R[i][j];
+            for (int32_t k = 0; k < n; k++) {
+                S[i][j] += HP[i][k] * f->H[j][k];
+            }
+            S[i][m + j] = i == j;
+        }
+    }
+    for (int32_t c = 0; c < m; c++) {
+        double pivot = S[c][c];
+        for (int32_t j = 0; j < 2 * m; j++) {
+            S[c][j] /= pivot;
+        }
+        for (int32_t i = 0; i < m; i++) {
+            double factor = S[i][c];
+            for (int32_t j = 0; j < 2 * m && i != c; j++) {
+                S[i][j] -= factor * S[c][j];
+            }
+        }
+    }
+    for (int32_t i = 0; i < n; i++) {
+        for (int32_t j = 0; j < m; j++) {
+            f->K[i][j] = 0;
+            for (int32_t k = 0; k < m; k++) {
+                f->K[i][j] += HP[k][i] * S[k][m + j];
+            }
+        }
+    }
+    for (int32_t i = 0; i < m; i++) {
+        innovation[i] = z[i];
+        for (int32_t k = 0; k < n; k++) {
+            innovation[i] -= f->H[i][k] * f->x[k];
+        }
+    }
+    for (int32_t i = 0; i < n; i++) {
+        for (int32_t j = 0; j < m; j++) {
+            f->x[i] += f->K[i][j] * innovation[j];
+        }
+        for (int32_t j = 0; j < n; j++) {
+            A[i][j] = i == j;
+            for (int32_t l = 0; l < m; l++) {
+                A[i][j] -= f->K[i][l] * f->H[l][j];
+            }
+        }
+    }
+    for (int32_t i = 0; i < n; i++) {
+        for (int32_t j = 0; j < n; j++) {
+            P[i][j] = 0;
+            for (int32_t k = 0; k < n; k++) {
+                P[i][j] += A[i][k] * f->P[k][j];
+            }
+        }
+    }
+    for (int32_t i = 0; i < n; i++) {
+        for (int32_t j = 0; j < n; j++) {
+            f->P[i][j] = 0;
+            for (int32_t k = 0; k < n; k++) {
+                f->P[i][j] += P[i][k] * A[j][k];
+            }
+            for (int32_t k = 0; k < m; k++) {
+                for (int32_t l = 0; l < m; l++) {
+                    f->P[i][j] += f->K[i][k] * f->R[k][l] * f->K[j][l];
+                }
+            }
+        }
+    }
+}
+
+// Two positions with their velocities, measured through a mixing H with
+// correlated noise, so H P H' + R is far from diagonal
+static void check_matrix(void) {
+    const double one = 1 << KALMAN_FRACTION_BITS;
+    const double F[CHECK_STATES][CHECK_STATES] = {
+        {1, 1.0 / 16, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 1.0 / 16}, {0, 0, 0, 1}};
+    const double H[CHECK_MEASUREMENTS][CHECK_STATES] = {{1, 0, 0.5, 0}, {0.25, 0, 1, 0}};
+    const double R[CHECK_MEASUREMENTS][CHECK_MEASUREMENTS] = {{0.1, 0.06}, {0.06, 0.2}};
+    double k_error = 0, x_error = 0;
+    KalmanDouble reference = {0};
+    KalmanMatrix kf;
+
+    kalman_matrix_init(&kf, CHECK_STATES, CHECK_MEASUREMENTS, 0);
+    for (int32_t i = 0; i < CHECK_STATES; i++) {
+        for (int32_t j = 0; j < CHECK_STATES; j++) {
+            reference.F[i][j] = F[i][j];
+            kf.F[i][j] = (int32_t)(F[i][j] * one);
+        }
+        reference.Q[i][i] = i % 2 ? 1e-2 : 1e-3;
+        kf.Q[i][i] = (int32_t)(reference.Q[i][i] * one + 0.5);
+        reference.Q[i][i] = kf.Q[i][i] / one;
+        reference.P[i][i] = 1;
+    }
+    for (int32_t i = 0; i < CHECK_MEASUREMENTS; i++) {
+        for (int32_t j = 0; j < CHECK_STATES; j++) {
+            reference.H[i][j] = H[i][j];
+            kf.H[i][j] = (int32_t)(H[i][j] * one);
+        }
+        for (int32_t j = 0; j < CHECK_MEASUREMENTS; j++) {
+            kf.R[i][j] = (int32_t)(R[i][j] * one + 0.5);
+            reference.R[i][j] = kf.R[i][j] / one;
+        }
+    }
+
+    for (int32_t s = 0; s < 2000; s++) {
+        int32_t z[CHECK_MEASUREMENTS];
+        double zd[CHECK_MEASUREMENTS];
+
+        for (int32_t i = 0; i < CHECK_MEASUREMENTS; i++) {
+            z[i] = (s * 7919 + i * 104729) % 8192 - 4096 + (s << 4);
+            zd[i] = z[i] / one;
+        }
+        kalman_matrix_predict(&kf, NULL);
+        double_predict(&reference);
+        if (kalman_matrix_update(&kf, z) != 0) {
+            printf("update failed at step %d\n", s);
+            return;
+        }
+        double_update(&reference, zd);
+        for (int32_t i = 0; i < CHECK_STATES; i++) {
+            for (int32_t j = 0; j < CHECK_MEASUREMENTS; j++) {
+                k_error = fmax(k_error, fabs(kf.K[i][j] / one - reference.K[i][j]));
+            }
+            x_error = fmax(x_error, fabs(kf.x[i] / one - reference.x[i]));
+        }
+    }
+    printf("Matrix Kalman filter against double, %d states, %d correlated measurements\n",
+           CHECK_STATES, CHECK_MEASUREMENTS);
+    printf("largest gain error %.6f, largest state error %.6f\n", k_error, x_error);
+    if (k_error > 1e-3 || x_error > 1e-3) {
+        printf("the gain or the state differs from the reference\n");
+    }
+    printf("\n");
+}
+
+int main(void) {
+    check_matrix();
+    benchmark_bank();
+    benchmark_matrix();
+    return 0;
+}
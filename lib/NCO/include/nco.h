@@ -0,0 +1,41 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief NCO_TABLE_BITS is the number of phase bits that index the sine
+ * table of NCO_LOOKUP, the rest of the phase interpolates between two
+ * entries. 2^10 entries keep the error below one LSB of
+ * CORDIC_MATH_FRACTION_BITS.
+ */
+#define NCO_TABLE_BITS 10
+/**
+ * @brief NCO_RENORMALIZE is the number of samples NCO_ROTATION rotates
+ * before it recalculates the exact sine and cosine from the phase
+ * accumulator, which removes the rounding errors of the rotations.
+ */
+#define NCO_RENORMALIZE 256
+
+typedef enum {
+    NCO_LOOKUP,     /* phase to amplitude through an interpolated sine table */
+    NCO_ROTATION    /* a complex multiplication by a fixed rotor per sample */
+} NcoMode;
+
+typedef struct {
+    NcoMode mode;
+    int32_t sample_rate;
+    uint32_t phase;             /* 2^32 is a full turn */
+    uint32_t step;              /* the frequency word, phase increment per sample */
+    int64_t rotor_cos;          /* NCO_ROTATION, the rotation per sample, 30 fraction bits */
+    int64_t rotor_sin;
+    int64_t cos;                /* NCO_ROTATION, the current output, 30 fraction bits */
+    int64_t sin;
+    int32_t until_renormalize;
+    int32_t table[(1 << NCO_TABLE_BITS) + 1];  /* NCO_LOOKUP, one turn of the sine */
+} Nco;
+
+int32_t nco_init(Nco *nco, NcoMode mode, int32_t frequency, int32_t sample_rate);
+int32_t nco_set_frequency(Nco *nco, int32_t frequency);
+void nco_set_frequency_word(Nco *nco, uint32_t word);
+void nco_set_phase(Nco *nco, int32_t phase);
+void nco_generate(Nco *nco, int32_t sine[], int32_t cosine[], int32_t count);
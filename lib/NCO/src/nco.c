@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "cordic-math.h"
+#include "nco.h"
+
+#define Q_BITS CORDIC_SINCOS_Q30_BITS
+#define Q_ONE ((int64_t)1 << Q_BITS)
+#define OUTPUT_SHIFT (Q_BITS - CORDIC_MATH_FRACTION_BITS)
+#define FRACTION_BITS (32 - NCO_TABLE_BITS)
+
+static inline int64_t q_mul(int64_t a, int64_t b) {
+    return (a * b + (Q_ONE >> 1)) >> Q_BITS;
+}
+
+/**
+ * @brief cordic_sincos_q30() into the 64 bit fields of the oscillator.
+ */
+static void sincos_q30(uint32_t phase, int64_t *sine, int64_t *cosine) {
+    int32_t s, c;
+
+    cordic_sincos_q30(phase, &s, &c);
+    *sine = s;
+    *cosine = c;
+}
+
+/**
+ * @brief Sets the oscillator to the exact sine and cosine of the phase
+ * accumulator.
+ */
+static void renormalize(Nco *nco) {
+    sincos_q30(nco->phase, &nco->sin, &nco->cos);
+    nco->until_renormalize = NCO_RENORMALIZE;
+}
+
+/**
+ * @brief Sets up a numerically controlled oscillator.
+ *
+ * @param nco the Nco to set up.
+ * @param mode NCO_LOOKUP or NCO_ROTATION, both have about the same accuracy.
+ * @param frequency in Hz, fixedpoint according to CORDIC_MATH_FRACTION_BITS,
+ * negative for a clockwise rotation.
+ * @param sample_rate in Hz.
+ *
+ * @return 0 on success, -1 if the frequency is beyond half the sample rate
+ * or the sample rate is invalid.
+ */
+int32_t nco_init(Nco *nco, NcoMode mode, int32_t frequency, int32_t sample_rate) {
+    memset(nco, 0, sizeof(Nco));
+    if (sample_rate < 1) {
+        return -1;
+    }
+    nco->mode = mode;
+    nco->sample_rate = sample_rate;
+    if (mode == NCO_LOOKUP) {
+        for (int32_t i = 0; i <= (1 << NCO_TABLE_BITS); i++) {
+            int32_t sine, cosine;
+            cordic_sincos_q30((uint32_t)i << FRACTION_BITS, &sine, &cosine);
+            nco->table[i] = (sine + (1 << (OUTPUT_SHIFT - 1))) >> OUTPUT_SHIFT;
+        }
+    }
+    return nco_set_frequency(nco, frequency);
+}
+
+/**
+ * @brief Changes the frequency. The phase accumulator is kept, so the
+ * output continues without a jump.
+ *
+ * @param nco the Nco.
+ * @param frequency in Hz, fixedpoint according to CORDIC_MATH_FRACTION_BITS.
+ *
+ * @return 0 on success, -1 if the frequency is beyond half the sample rate,
+ * the frequency is not changed then.
+ */
+int32_t nco_set_frequency(Nco *nco, int32_t frequency) {
+    int64_t half = (int64_t)nco->sample_rate << (CORDIC_MATH_FRACTION_BITS - 1);
+
+    if (frequency > half || frequency < -half) {
+        return -1;
+    }
+    /* frequency / sample_rate of a turn of 2^32 */
+    nco_set_frequency_word(nco, (uint32_t)(((int64_t)frequency
+                                            << (32 - CORDIC_MATH_FRACTION_BITS)) /
+                                           nco->sample_rate));
+    return 0;
+}
+
+/**
+ * @brief Sets the phase increment per sample directly, for frequencies
+ * CORDIC_MATH_FRACTION_BITS cannot hold. Like nco_set_frequency() the
+ * phase accumulator is kept.
+ *
+ * @param nco the Nco.
+ * @param word the frequency as a fraction of the sample rate, 2^32 is the
+ * sample rate, values from 2^31 on are negative frequencies.
+ */
+void nco_set_frequency_word(Nco *nco, uint32_t word) {
+    nco->step = word;
+    sincos_q30(nco->step, &nco->rotor_sin, &nco->rotor_cos);
+    renormalize(nco);
+}
+
+/**
+ * @brief Sets the phase of the next sample.
+ *
+ * @param nco the Nco.
+ * @param phase in degrees, fixedpoint according to CORDIC_MATH_FRACTION_BITS.
+ */
+void nco_set_phase(Nco *nco, int32_t phase) {
+    int64_t turn = (int64_t)360 << CORDIC_MATH_FRACTION_BITS;
+
+    phase %= turn;
+    nco->phase = (uint32_t)(phase * ((int64_t)1 << 32) / turn);
+    renormalize(nco);
+}
+
+/**
+ * @brief Generates the next count samples of the oscillator. NCO_LOOKUP
+ * costs two table reads and two multiplications per sample, NCO_ROTATION
+ * four multiplications.
+ *
+ * @param nco the Nco.
+ * @param sine the sine of every sample, fixedpoint according to
+ * CORDIC_MATH_FRACTION_BITS.
+ * @param cosine the cosine of every sample, same format.
+ * @param count the number of samples.
+ */
+void nco_generate(Nco *nco, int32_t sine[], int32_t cosine[], int32_t count) {
+    const int64_t round = (int64_t)1 << (OUTPUT_SHIFT - 1);
+
+    if (nco->mode == NCO_LOOKUP) {
+        const int32_t *table = nco->table;
+        uint32_t phase = nco->phase, step = nco->step;
+
+        for (int32_t n = 0; n < count; n++) {
+            /* A quarter turn ahead is the cosine */
+            uint32_t quarter = phase + (1u << 30);
+            uint32_t i = phase >> FRACTION_BITS, j = quarter >> FRACTION_BITS;
+            int32_t a = (int32_t)((phase >> (FRACTION_BITS - 15)) & 0x7fff);
+            int32_t b = (int32_t)((quarter >> (FRACTION_BITS - 15)) & 0x7fff);
+
+            sine[n] = table[i] + (((table[i + 1] - table[i]) * a + (1 << 14)) >> 15);
+            cosine[n] = table[j] + (((table[j + 1] - table[j]) * b + (1 << 14)) >> 15);
+            phase += step;
+        }
+        nco->phase = phase;
+        return;
+    }
+
+    while (count > 0) {
+        int32_t n = count < nco->until_renormalize ? count : nco->until_renormalize;
+        int64_t c = nco->cos, s = nco->sin;
+        const int64_t rc = nco->rotor_cos, rs = nco->rotor_sin;
+
+        for (int32_t i = 0; i < n; i++) {
+            int64_t next = (c * rc - s * rs + (Q_ONE >> 1)) >> Q_BITS;
+
+            sine[i] = (int32_t)((s + round) >> OUTPUT_SHIFT);
+            cosine[i] = (int32_t)((c + round) >> OUTPUT_SHIFT);
+            s = (s * rc + c * rs + (Q_ONE >> 1)) >> Q_BITS;
+            c = next;
+        }
+        nco->cos = c;
+        nco->sin = s;
+        nco->phase += nco->step * (uint32_t)n;
+        nco->until_renormalize -= n;
+        if (nco->until_renormalize == 0) {
+            renormalize(nco);
+        }
+        sine += n;
+        cosine += n;
+        count -= n;
+    }
+}
@@ -0,0 +1,95 @@
+// Benchmarks for the NCO library.
+//
+// Build from the lib folder:
+//   gcc -O2 -IcordicMath/include -INCO/include NCO_benchmark.c cordicMath/src/*.c NCO/src/*.c -o nco_benchmark -lm
+//
+// Generates a tone as a sine and a cosine per sample, with a cordic call
+// per sample and with the Nco. The frequency is a whole number of phase
+// steps in both, so the error is the largest difference to sin() and cos()
+// in LSB, not the frequency resolution.
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "cordic-math.h"
+#include "nco.h"
+
+#define SAMPLES 4096
+#define ROUNDS 256
+#define SAMPLE_RATE 65536
+#define FREQUENCY 1024
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The largest error of one block against the exact tone starting at
+// sample first
+static double block_error(const int32_t sine[], const int32_t cosine[], int64_t first) {
+    double error = 0;
+
+    for (int32_t n = 0; n < SAMPLES; n++) {
+        double phase = 2 * M_PI * FREQUENCY * (double)(first + n) / SAMPLE_RATE;
+        error = fmax(error, fabs(sine[n] - 65536.0 * sin(phase)));
+        error = fmax(error, fabs(cosine[n] - 65536.0 * cos(phase)));
+    }
+    return error;
+}
+
+static void report(const char *name, double seconds, double error) {
+    printf("%-28s %12.1f %10.1f\n", name, SAMPLES * ROUNDS / seconds * 1e-6, error);
+}
+
+int main(void) {
+    static int32_t sine[SAMPLES], cosine[SAMPLES];
+    const int32_t turn = 360 << CORDIC_MATH_FRACTION_BITS;
+    /* Degrees per sample */
+    const int32_t step = (int32_t)(((int64_t)FREQUENCY * turn) / SAMPLE_RATE);
+    double t0;
+    int32_t phase = 0;
+
+    printf("%-28s %12s %10s\n", "1024 Hz tone at 65536 Hz", "Msamples/s", "error LSB");
+
+    t0 = now_seconds();
+    for (int32_t r = 0; r < ROUNDS; r++) {
+        for (int32_t n = 0; n < SAMPLES; n++) {
+            sine[n] = cordic_sin(phase);
+            cosine[n] = cordic_cos(phase);
+            phase += step;
+            if (phase >= turn) {
+                phase -= turn;
+            }
+        }
+    }
+    report("cordic_sin() + cordic_cos()", now_seconds() - t0,
+           block_error(sine, cosine, (int64_t)SAMPLES * (ROUNDS - 1)));
+
+    phase = 0;
+    t0 = now_seconds();
+    for (int32_t r = 0; r < ROUNDS; r++) {
+        for (int32_t n = 0; n < SAMPLES; n++) {
+            cordic_sincos(phase, &sine[n], &cosine[n]);
+            phase += step;
+            if (phase >= turn) {
+                phase -= turn;
+            }
+        }
+    }
+    report("cordic_sincos()", now_seconds() - t0,
+           block_error(sine, cosine, (int64_t)SAMPLES * (ROUNDS - 1)));
+
+    for (int32_t mode = NCO_LOOKUP; mode <= NCO_ROTATION; mode++) {
+        Nco nco;
+
+        nco_init(&nco, (NcoMode)mode, FREQUENCY << CORDIC_MATH_FRACTION_BITS, SAMPLE_RATE);
+        t0 = now_seconds();
+        for (int32_t r = 0; r < ROUNDS; r++) {
+            nco_generate(&nco, sine, cosine, SAMPLES);
+        }
+        report(mode == NCO_LOOKUP ? "Nco, lookup" : "Nco, rotation", now_seconds() - t0,
+               block_error(sine, cosine, (int64_t)SAMPLES * (ROUNDS - 1)));
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "stdint.h"
+
+/**
+ * @brief POOL_CACHE_LINE is the alignment of the slabs and of every block,
+ * so two blocks never share a cache line.
+ */
+#define POOL_CACHE_LINE 64
+/**
+ * @brief POOL_ARENA_MAX_CLASSES is the largest number of block sizes in a
+ * PoolArena.
+ */
+#define POOL_ARENA_MAX_CLASSES 8
+
+typedef struct {
+    int32_t block_size;  /* bytes, a multiple of POOL_CACHE_LINE */
+    int32_t blocks;
+    int32_t in_use;
+    int32_t peak;        /* the largest in_use so far */
+    int64_t acquired;    /* successful pool_acquire() calls */
+    int64_t failed;      /* requests that returned NULL */
+} PoolStats;
+
+/* Blocks of one size from a single preallocated slab. The free blocks form
+ * a list through their first bytes, so acquire and release are O(1). One
+ * byte per block marks the blocks in use, so a block released twice is
+ * rejected in O(1). A Pool is not thread safe, use one per thread. */
+typedef struct {
+    unsigned char *slab;
+    unsigned char *used;  /* 1 for every block in use */
+    void *free_list;
+    PoolStats stats;
+} Pool;
+
+/* Pools of different block sizes, a request is served from the smallest
+ * block that fits */
+typedef struct {
+    int32_t classes;
+    Pool pools[POOL_ARENA_MAX_CLASSES];
+} PoolArena;
+
+int32_t pool_init(Pool *pool, int32_t block_size, int32_t blocks);
+void *pool_acquire(Pool *pool);
+int32_t pool_release(Pool *pool, void *block);
+int32_t pool_owns(const Pool *pool, const void *block);
+void pool_stats(const Pool *pool, PoolStats *stats);
+void pool_free(Pool *pool);
+int32_t pool_arena_init(PoolArena *arena, const int32_t block_sizes[], const int32_t blocks[],
+                        int32_t classes);
+void *pool_arena_acquire(PoolArena *arena, int32_t size);
+int32_t pool_arena_release(PoolArena *arena, void *block);
+int32_t pool_arena_stats(const PoolArena *arena, PoolStats stats[]);
+void pool_arena_free(PoolArena *arena);
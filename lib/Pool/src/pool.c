@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+/**
+ * @brief Allocates the slab of a pool and links all its blocks into the
+ * free list. Nothing is allocated after this.
+ *
+ * @param pool the Pool to set up.
+ * @param block_size the size of a block in bytes, rounded up to a multiple
+ * of POOL_CACHE_LINE.
+ * @param blocks the number of blocks.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t pool_init(Pool *pool, int32_t block_size, int32_t blocks) {
+    size_t size;
+
+    memset(pool, 0, sizeof(Pool));
+    if (block_size < 1 || blocks < 1 || block_size > INT32_MAX - POOL_CACHE_LINE) {
+        return -1;
+    }
+    block_size = (block_size + POOL_CACHE_LINE - 1) & ~(POOL_CACHE_LINE - 1);
+    size = (size_t)block_size * blocks;
+    pool->slab = aligned_alloc(POOL_CACHE_LINE, size);
+    pool->used = calloc((size_t)blocks, 1);
+    if (pool->slab == NULL || pool->used == NULL) {
+        pool_free(pool);
+        return -1;
+    }
+    pool->stats.block_size = block_size;
+    pool->stats.blocks = blocks;
+
+    /* Linked from the end so the first acquire returns the first block */
+    for (int32_t i = blocks - 1; i >= 0; i--) {
+        void *block = pool->slab + (size_t)i * block_size;
+        *(void **)block = pool->free_list;
+        pool->free_list = block;
+    }
+    return 0;
+}
+
+/**
+ * @brief Takes a block from the pool. The content is undefined.
+ *
+ * @return Pointer to a block aligned to POOL_CACHE_LINE, NULL if every
+ * block is in use.
+ */
+void *pool_acquire(Pool *pool) {
+    void *block = pool->free_list;
+
+    if (block == NULL) {
+        pool->stats.failed++;
+        return NULL;
+    }
+    pool->free_list = *(void **)block;
+    pool->used[((unsigned char *)block - pool->slab) / pool->stats.block_size] = 1;
+    pool->stats.acquired++;
+    if (++pool->stats.in_use > pool->stats.peak) {
+        pool->stats.peak = pool->stats.in_use;
+    }
+    return block;
+}
+
+/**
+ * @brief Whether a pointer is the start of a block of this pool.
+ *
+ * @return 1 if it is, 0 otherwise.
+ */
+int32_t pool_owns(const Pool *pool, const void *block) {
+    const unsigned char *p = block;
+    size_t offset;
+
+    if (pool->slab == NULL || p < pool->slab) {
+        return 0;
+    }
+    offset = (size_t)(p - pool->slab);
+    return offset < (size_t)pool->stats.block_size * pool->stats.blocks &&
+           offset % pool->stats.block_size == 0;
+}
+
+/**
+ * @brief Returns a block to the pool. A block released twice would link the
+ * free list into a loop, so a block that is not marked in use is rejected.
+ *
+ * @param pool the Pool the block was acquired from.
+ * @param block the block, NULL is ignored.
+ *
+ * @return 0 on success, -1 if the block does not belong to the pool or is
+ * not in use.
+ */
+int32_t pool_release(Pool *pool, void *block) {
+    size_t index;
+
+    if (block == NULL) {
+        return 0;
+    }
+    if (!pool_owns(pool, block)) {
+        return -1;
+    }
+    index = (size_t)((unsigned char *)block - pool->slab) / pool->stats.block_size;
+    if (!pool->used[index]) {
+        return -1;
+    }
+    pool->used[index] = 0;
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    pool->stats.in_use--;
+    return 0;
+}
+
+/**
+ * @brief Copies the usage statistics of the pool.
+ */
+void pool_stats(const Pool *pool, PoolStats *stats) {
+    *stats = pool->stats;
+}
+
+/**
+ * @brief Frees the memory allocated by pool_init(), every block of the pool
+ * becomes invalid.
+ */
+void pool_free(Pool *pool) {
+    free(pool->slab);
+    free(pool->used);
+    memset(pool, 0, sizeof(Pool));
+}
+
+/**
+ * @brief Sets up one pool per block size, for example small blocks for
+ * KalmanFilter structs and large ones for FFT work buffers and sample rings.
+ *
+ * @param arena the PoolArena to set up.
+ * @param block_sizes the block size of every class in bytes, ascending.
+ * @param blocks the number of blocks of every class.
+ * @param classes the number of classes, at most POOL_ARENA_MAX_CLASSES.
+ *
+ * @return 0 on success, -1 if the arguments are invalid or the memory could
+ * not be allocated.
+ */
+int32_t pool_arena_init(PoolArena *arena, const int32_t block_sizes[], const int32_t blocks[],
+                        int32_t classes) {
+    memset(arena, 0, sizeof(PoolArena));
+    if (classes < 1 || classes > POOL_ARENA_MAX_CLASSES) {
+        return -1;
+    }
+    for (int32_t c = 0; c < classes; c++) {
+        if ((c > 0 && block_sizes[c] <= block_sizes[c - 1]) ||
+            pool_init(&arena->pools[c], block_sizes[c], blocks[c]) != 0) {
+            pool_arena_free(arena);
+            return -1;
+        }
+        arena->classes = c + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Takes a block of at least size bytes from the smallest class that
+ * fits. When that class is empty the next larger class is used. A request
+ * no class can serve counts as a failure of the smallest class that fits.
+ *
+ * @return Pointer to a block aligned to POOL_CACHE_LINE, NULL if no class
+ * that fits has a free block.
+ */
+void *pool_arena_acquire(PoolArena *arena, int32_t size) {
+    Pool *first = NULL;
+
+    for (int32_t c = 0; c < arena->classes; c++) {
+        Pool *pool = &arena->pools[c];
+        if (pool->stats.block_size >= size) {
+            if (pool->free_list != NULL) {
+                return pool_acquire(pool);
+            }
+            if (first == NULL) {
+                first = pool;
+            }
+        }
+    }
+    if (first != NULL) {
+        first->stats.failed++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns a block to the class it was acquired from.
+ *
+ * @return 0 on success, -1 if the block does not belong to the arena.
+ */
+int32_t pool_arena_release(PoolArena *arena, void *block) {
+    if (block == NULL) {
+        return 0;
+    }
+    for (int32_t c = 0; c < arena->classes; c++) {
+        if (pool_owns(&arena->pools[c], block)) {
+            return pool_release(&arena->pools[c], block);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Copies the usage statistics of every class.
+ *
+ * @param stats room for POOL_ARENA_MAX_CLASSES entries.
+ *
+ * @return The number of classes.
+ */
+int32_t pool_arena_stats(const PoolArena *arena, PoolStats stats[]) {
+    for (int32_t c = 0; c < arena->classes; c++) {
+        pool_stats(&arena->pools[c], &stats[c]);
+    }
+    return arena->classes;
+}
+
+/**
+ * @brief Frees every slab of the arena.
+ */
+void pool_arena_free(PoolArena *arena) {
+    for (int32_t c = 0; c < POOL_ARENA_MAX_CLASSES; c++) {
+        pool_free(&arena->pools[c]);
+    }
+    arena->classes = 0;
+}
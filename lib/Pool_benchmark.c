@@ -0,0 +1,124 @@
+// Benchmarks for the Pool library.
+//
+// Build from the lib folder:
+//   gcc -O2 -IPool/include -IKalman/include -IFFT/include Pool_benchmark.c Pool/src/*.c Kalman/src/*.c -o pool_benchmark
+//
+// Channels are created and destroyed in a random order while others stay
+// alive, the way sensor channels come and go. Every channel holds a
+// KalmanFilter, an FFT work buffer and a sample ring, taken either from
+// malloc() or from a PoolArena.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fft.h"
+#include "kalman.h"
+#include "pool.h"
+
+#define CHANNELS 1024
+#define OPERATIONS 2000000
+#define FFT_SIZE 512
+#define RING_SIZE 256
+
+typedef struct {
+    KalmanFilter *filter;
+    Complex *work;       /* FFT_SIZE bins */
+    int32_t *ring;       /* RING_SIZE samples */
+} Channel;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+// Opens a channel in a free slot or closes an open one, touching the first
+// line of every buffer like a filter would
+static double churn(PoolArena *arena) {
+    static Channel channels[CHANNELS];
+    uint32_t state = 1;
+    double t0 = now_seconds(), t1;
+
+    memset(channels, 0, sizeof(channels));
+    for (int32_t i = 0; i < OPERATIONS; i++) {
+        Channel *channel = &channels[next_random(&state) % CHANNELS];
+
+        if (channel->filter == NULL) {
+            if (arena != NULL) {
+                channel->filter = pool_arena_acquire(arena, sizeof(KalmanFilter));
+                channel->work = pool_arena_acquire(arena, sizeof(Complex) * FFT_SIZE);
+                channel->ring = pool_arena_acquire(arena, sizeof(int32_t) * RING_SIZE);
+            } else {
+                channel->filter = malloc(sizeof(KalmanFilter));
+                channel->work = malloc(sizeof(Complex) * FFT_SIZE);
+                channel->ring = malloc(sizeof(int32_t) * RING_SIZE);
+            }
+            kalman_init(channel->filter, 1 << 10, 1 << 14, 0);
+            channel->work[0].real = i;
+            channel->ring[0] = i;
+        } else {
+            if (arena != NULL) {
+                pool_arena_release(arena, channel->filter);
+                pool_arena_release(arena, channel->work);
+                pool_arena_release(arena, channel->ring);
+            } else {
+                free(channel->filter);
+                free(channel->work);
+                free(channel->ring);
+            }
+            memset(channel, 0, sizeof(Channel));
+        }
+    }
+    t1 = now_seconds();
+
+    for (int32_t c = 0; c < CHANNELS; c++) {
+        if (arena != NULL) {
+            pool_arena_release(arena, channels[c].filter);
+            pool_arena_release(arena, channels[c].work);
+            pool_arena_release(arena, channels[c].ring);
+        } else {
+            free(channels[c].filter);
+            free(channels[c].work);
+            free(channels[c].ring);
+        }
+    }
+    return t1 - t0;
+}
+
+int main(void) {
+    const int32_t sizes[] = {64, sizeof(int32_t) * RING_SIZE, sizeof(Complex) * FFT_SIZE};
+    const int32_t blocks[] = {CHANNELS, CHANNELS, CHANNELS};
+    PoolStats stats[POOL_ARENA_MAX_CLASSES];
+    PoolArena arena;
+    double t_malloc, t_pool;
+    int32_t classes;
+
+    if (pool_arena_init(&arena, sizes, blocks, 3) != 0) {
+        printf("out of memory\n");
+        return 1;
+    }
+    t_malloc = churn(NULL);
+    t_pool = churn(&arena);
+
+    printf("Channel create/destroy, %d channels, %d operations, 3 buffers each\n", CHANNELS,
+           OPERATIONS);
+    printf("%-12s %12.1f ns/operation\n", "malloc", t_malloc / OPERATIONS * 1e9);
+    printf("%-12s %12.1f ns/operation\n\n", "PoolArena", t_pool / OPERATIONS * 1e9);
+
+    classes = pool_arena_stats(&arena, stats);
+    printf("%-12s %8s %8s %8s %12s %8s\n", "block size", "blocks", "in use", "peak",
+           "acquired", "failed");
+    for (int32_t c = 0; c < classes; c++) {
+        printf("%-12d %8d %8d %8d %12lld %8lld\n", stats[c].block_size, stats[c].blocks,
+               stats[c].in_use, stats[c].peak, (long long)stats[c].acquired,
+               (long long)stats[c].failed);
+    }
+    pool_arena_free(&arena);
+    return 0;
+}
@@ -14,6 +14,11 @@
  * This variable can be lowered to get more speed and less accuracy. Default is 15.
  */
 #define CORDIC_SPEED_FACTOR 15
+/**
+ * @brief CORDIC_SINCOS_Q30_BITS is the number of fraction bits of
+ * cordic_sincos_q30(), which does not use the cordic algorithm.
+ */
+#define CORDIC_SINCOS_Q30_BITS 30
 
 typedef struct {
 	int x;
@@ -24,8 +29,11 @@ typedef struct {
 
 int32_t cordic_atan(int32_t y, int32_t x);
 int32_t cordic_hypotenuse(int32_t y, int32_t x);
+int32_t cordic_vector(int32_t y, int32_t x, int32_t *magnitude, int32_t *angle);
 int32_t cordic_cos(int32_t theta);
 int32_t cordic_sin(int32_t theta);
+int32_t cordic_sincos(int32_t theta, int32_t *sinTheta, int32_t *cosTheta);
+int32_t cordic_sincos_q30(uint32_t phase, int32_t *sine, int32_t *cosine);
 int32_t cordic_asin(int32_t yInput);
 int32_t cordic_acos(int32_t xInput);
 int32_t cordic_tan(int32_t theta);
@@ -1,3 +1,5 @@
+#include <stddef.h>
+
 #include "cordic-math.h"
 
 
@@ -10,6 +12,8 @@ static const uint32_t CORDIC_GAIN_HYPERBOLIC_CIRCULAR = FLOAT_TO_INT(1.64676 * (
 static const uint32_t DECIMAL_TO_FP = (1 << CORDIC_MATH_FRACTION_BITS);
 static const uint32_t PI = FLOAT_TO_INT(3.14159265359 * (1 << CORDIC_MATH_FRACTION_BITS));
 static const uint32_t ONE_EIGHTY_DIV_PI = FLOAT_TO_INT((180 / 3.14159265359) * (1 << CORDIC_MATH_FRACTION_BITS));
+/* pi / 2 with CORDIC_SINCOS_Q30_BITS fraction bits */
+static const int64_t HALF_PI_Q30 = 1686629713;
 static const uint32_t ONE_DIV_CORDIC_GAIN_HYPERBOLIC = FLOAT_TO_INT((1.0 / 0.82816) * (1 << CORDIC_MATH_FRACTION_BITS));
 
 static const uint32_t LUT_CORDIC_ATAN[15] =  {FLOAT_TO_INT(45.0000 * (1 << CORDIC_MATH_FRACTION_BITS)),  /* 45.000    degrees */
@@ -139,6 +143,57 @@ int32_t cordic_hypotenuse(int32_t y, int32_t x) {
     return ((long)x * CORDIC_GAIN) >> CORDIC_MATH_FRACTION_BITS;
 }
 
+/**
+ * @brief Fast fixedpoint magnitude and angle of the same vector using one
+ * pass of the cordic algorithm, the work of cordic_hypotenuse() and
+ * cordic_atan() together. All four quadrants are handled and the internal
+ * values are 64 bit, so inputs up to the full 32 bit range do not overflow,
+ * a magnitude above the 32 bit range is saturated.
+ *
+ * @param y fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param x fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param magnitude pointer where sqrt( x*x + y*y ) is stored, NULL is allowed
+ * @param angle pointer where the angle of (x, y) in degrees is stored,
+ * -180 < angle <= 180, fixedpoint according to CORDIC_MATH_FRACTION_BITS, NULL is allowed
+ *
+ * @return 0, the answer is in magnitude and angle
+ */
+int32_t cordic_vector(int32_t y, int32_t x, int32_t *magnitude, int32_t *angle) {
+    int64_t x64 = x, y64 = y, tempX;
+    int32_t sumAngle = 0;
+
+    /* Rotate the left half plane by 180 degrees */
+    if (x64 < 0) {
+        x64 = -x64;
+        y64 = -y64;
+        sumAngle = (y < 0 ? -180 : 180) << CORDIC_MATH_FRACTION_BITS;
+    }
+
+    for (int i = 0; i < CORDIC_SPEED_FACTOR; i++) {
+        tempX = x64;
+        if (y64 > 0) {
+            /* Rotate clockwise */
+            x64 += (y64 >> i);
+            y64 -= (tempX >> i);
+            sumAngle += LUT_CORDIC_ATAN[i];
+        } else {
+            /* Rotate counterclockwise */
+            x64 -= (y64 >> i);
+            y64 += (tempX >> i);
+            sumAngle -= LUT_CORDIC_ATAN[i];
+        }
+    }
+
+    if (magnitude != NULL) {
+        x64 = (x64 * CORDIC_GAIN) >> CORDIC_MATH_FRACTION_BITS;
+        *magnitude = x64 > INT32_MAX ? INT32_MAX : (int32_t)x64;
+    }
+    if (angle != NULL) {
+        *angle = sumAngle;
+    }
+    return 0;
+}
+
 /**
  * @brief Fast fixedpoint cossinus using the cordic algorithm
  *
@@ -221,6 +276,117 @@ int32_t cordic_sin(int32_t theta) {
     return y;
 }
 
+/**
+ * @brief Fast fixedpoint sinus and cossinus of the same angle using one pass
+ * of the cordic algorithm. Any angle is accepted, negative angles and angles
+ * above 360 degrees are folded into the first quadrant before the rotation.
+ *
+ * @param theta fixedpoint according to CORDIC_MATH_FRACTION_BITS in degrees
+ * @param sinTheta pointer where sin(theta) is stored, fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ * @param cosTheta pointer where cos(theta) is stored, fixedpoint according to CORDIC_MATH_FRACTION_BITS
+ *
+ * @return 0, the answer is in sinTheta and cosTheta
+ */
+int32_t cordic_sincos(int32_t theta, int32_t *sinTheta, int32_t *cosTheta) {
+    int x = CORDIC_GAIN, y = 0, sumAngle = 0, tempX, quadrant,
+        ninety = (90 << CORDIC_MATH_FRACTION_BITS);
+
+    theta %= (360 << CORDIC_MATH_FRACTION_BITS);
+    if (theta < 0) {
+        theta += (360 << CORDIC_MATH_FRACTION_BITS);
+    }
+    quadrant = theta / ninety;
+    theta -= quadrant * ninety;
+
+    for (int i = 0; i < CORDIC_SPEED_FACTOR; i++) {
+        tempX = x;
+        if (theta > sumAngle) {
+            /* Rotate counter clockwise */
+            x -= (y >> i);
+            y += (tempX >> i);
+            sumAngle += LUT_CORDIC_ATAN[i];
+        } else {
+            /* Rotate clockwise */
+            x += (y >> i);
+            y -= (tempX >> i);
+            sumAngle -= LUT_CORDIC_ATAN[i];
+        }
+    }
+
+    /* Rotate the result back into the original quadrant */
+    switch (quadrant) {
+    case 1:
+        tempX = x;
+        x = -y;
+        y = tempX;
+        break;
+    case 2:
+        x = -x;
+        y = -y;
+        break;
+    case 3:
+        tempX = x;
+        x = y;
+        y = -tempX;
+        break;
+    default:
+        break;
+    }
+
+    *sinTheta = y;
+    *cosTheta = x;
+    return 0;
+}
+
+/**
+ * @brief Sine and cosine of a phase with CORDIC_SINCOS_Q30_BITS fraction
+ * bits, for coefficients and rotors where the 1e-4 of cordic_sincos() is not
+ * enough. The phase is folded into the first quadrant and the Taylor series
+ * to the 14th order is evaluated with Horner's rule, which is exact to a few
+ * LSB of Q30.
+ *
+ * @param phase the angle where 2^32 is a full turn.
+ * @param sine pointer where sin(phase) is stored.
+ * @param cosine pointer where cos(phase) is stored.
+ *
+ * @return 0, the answer is in sine and cosine
+ */
+int32_t cordic_sincos_q30(uint32_t phase, int32_t *sine, int32_t *cosine) {
+    const int64_t one = (int64_t)1 << CORDIC_SINCOS_Q30_BITS;
+    const int64_t half = one >> 1;
+    int64_t x = ((int64_t)(phase & 0x3fffffff) * HALF_PI_Q30) >> CORDIC_SINCOS_Q30_BITS;
+    int64_t x2 = (x * x + half) >> CORDIC_SINCOS_Q30_BITS;
+    int64_t s = one, c = one;
+
+    for (int32_t n = 13; n > 1; n -= 2) {
+        s = one - ((x2 * s + half) >> CORDIC_SINCOS_Q30_BITS) / (n * (n - 1));
+    }
+    for (int32_t n = 14; n > 0; n -= 2) {
+        c = one - ((x2 * c + half) >> CORDIC_SINCOS_Q30_BITS) / (n * (n - 1));
+    }
+    s = (x * s + half) >> CORDIC_SINCOS_Q30_BITS;
+
+    switch (phase >> 30) {
+    case 0:
+        *sine = (int32_t)s;
+        *cosine = (int32_t)c;
+        break;
+    case 1:
+        *sine = (int32_t)c;
+        *cosine = (int32_t)-s;
+        break;
+    case 2:
+        *sine = (int32_t)-s;
+        *cosine = (int32_t)-c;
+        break;
+    default:
+        *sine = (int32_t)-c;
+        *cosine = (int32_t)s;
+        break;
+    }
+    return 0;
+}
+
 /**
  * @brief Fast fixedpoint arccosinus using the cordic algorithm
  *